@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""Encodes a text command script into binary protocol frames.
+
+Usage: bench/encode.py [<script>] > <frames>
+
+Each command becomes one frame: a 4 byte big-endian payload size, then the
+command character, then its arguments as 4 byte big-endian integers and
+strings with a 1 byte size. The moves of an M batch, on the lines that
+follow it, go in the same frame.
+"""
+
+import struct
+import sys
+
+# Argument layout of each command, i for an integer, s for a string. The
+# last string of a command takes the rest of its line.
+LAYOUTS = {
+    "t": "is", "n": "i", "u": "s", "m": "iss", "a": "s", "d": "s",
+    "L": "ii", "D": "iis", "s": "i", "e": "ii", "x": "i", "h": "is",
+    "H": "ii", "w": "s", "b": "s", "T": "ss", "K": "ii",
+}
+
+
+def integer(x):
+    return struct.pack(">i", int(x))
+
+
+def string(x):
+    data = x.encode()
+    return bytes([len(data)]) + data
+
+
+def fields(layout, args):
+    parts = args.split(None, len(layout) - 1) if layout else []
+    return b"".join(integer(p) if kind == "i" else string(p)
+                    for kind, p in zip(layout, parts))
+
+
+def encode(lines):
+    frames = []
+    lines = iter(lines)
+    for line in lines:
+        if not line:
+            continue
+        code, args = line[0], line[2:]
+        payload = code.encode()
+        if code == "l":
+            payload += b"".join(integer(x) for x in args.split())
+        elif code == "M" and args:
+            payload += integer(args)
+            for _ in range(int(args)):
+                move = next(lines, "")
+                payload += fields(LAYOUTS["m"], move) if move else b""
+        elif args:
+            payload += fields(LAYOUTS.get(code, ""), args)
+        frames.append(struct.pack(">I", len(payload)) + payload)
+    return b"".join(frames)
+
+
+def main():
+    script = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    sys.stdout.buffer.write(encode(script.read().split("\n")))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,39 @@
+#!/usr/bin/env python3
+"""Generates the workloads for deferred description sorting.
+
+Usage: bench/lazy.py write|mixed > <script>
+
+20 boards of 10000 t each, in random description order. The write workload
+lists each board once, at the end. The mixed one also lists every 100 t and
+displays TO DO every 250 t.
+
+    bench/lazy.py write > w.txt && time ./kanban < w.txt > /dev/null
+"""
+
+import random
+import sys
+
+BOARDS = 20
+TASKS = 10000
+
+
+def main():
+    mode = sys.argv[1] if len(sys.argv) > 1 else "write"
+    rand = random.Random(7)
+    out = []
+    for board in range(BOARDS):
+        out.append("b board%d" % board)
+        for i in range(TASKS):
+            out.append("t %d task %08d %d" % (rand.randint(1, 99),
+                                              rand.randrange(10 ** 8), i))
+            if mode == "mixed" and i % 100 == 99:
+                out.append("l")
+            if mode == "mixed" and i % 250 == 249:
+                out.append("d TO DO")
+        out.append("l")
+    out.append("q")
+    sys.stdout.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,39 @@
+#!/usr/bin/env python3
+"""Generates the workload for comparing the text and binary protocols.
+
+Usage: bench/protocol.py [<commands>] > <script>
+
+One board with 10000 tasks, then <commands> (3M by default) mixed m and
+l <id> commands on random tasks. Time it as text, and as binary frames:
+
+    bench/protocol.py > p.txt && bench/encode.py p.txt > p.bin
+    time ./kanban < p.txt > /dev/null
+    time ./kanban -b < p.bin > /dev/null
+"""
+
+import random
+import sys
+
+TASKS = 10000
+ACTIVITIES = ["IN PROGRESS", "DONE", "TO DO"]
+
+
+def main():
+    commands = int(sys.argv[1]) if len(sys.argv) > 1 else 3000000
+    rand = random.Random(28)
+    out = ["u ana", "u rui"]
+    out += ["t %d task number %d" % (rand.randint(1, 99), i)
+            for i in range(TASKS)]
+    for _ in range(commands):
+        task = rand.randint(1, TASKS)
+        if rand.random() < 0.5:
+            out.append("m %d %s %s" % (task, rand.choice(["ana", "rui"]),
+                                       rand.choice(ACTIVITIES)))
+        else:
+            out.append("l %d" % task)
+    out.append("q")
+    sys.stdout.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -6,6 +6,8 @@
 
 /* OK return exit code */
 #define EXIT_OK 0
+/* Exit code when the command file can't be opened */
+#define EXIT_ERROR 1
 
 /* Keep program running or stop it */
 #define KEEP_GOING 1
@@ -18,9 +20,17 @@
 #define AMT_TASKS 10000
 /* Maximum size for the descripion string of a task. */
 #define TASK_DESCRIPTION_SZ 51
+/* Maximum amount of new tasks left out of the description order. */
+#define MAX_UNSORTED_TASKS 128
 
-/* Maximum amount of users stored. */
-#define AMT_USERS 50
+/* Users in a new user list, the list doubles when full. */
+#define USERS_INITIAL_SZ 16
+/* Limit of a list that has none. */
+#define NO_LIMIT -1
+/* Tasks in a new user task index, the index doubles when full. */
+#define USER_TASKS_INITIAL_SZ 4
+/* Amount of tasks in a user task index that was lost. */
+#define NO_INDEX -1
 /* Maximum size for the user string. */
 #define USER_SZ 21
 
@@ -28,6 +38,18 @@
 #define AMT_ACTIVITIES 10
 /* Maxium size for the activity string. */
 #define ACTIVITY_SZ 21
+/* Size of a key slot: users and activities zero padded for SIMD compares. */
+#define KEY_SZ 32
+/* Index of a key that is not in a table. */
+#define NO_KEY -1
+
+/* Index of an activity that is not in the kanban. */
+#define NO_ACTIVITY -1
+/* Index of the TO DO and DONE activities. */
+#define TO_DO 0
+#define DONE 2
+/* Index of a user that is not in the kanban. */
+#define NO_USER -1
 
 /* Names of the default activities. */
 #define STR_TO_DO "TO DO"
@@ -61,21 +83,223 @@
 #define STR_FAIL_MOVE_TASK_TASK_ALREADY_STARTED "task already started\n"
 #define STR_FAIL_MOVE_TASK_NO_SUCH_USER "no such user\n"
 #define STR_FAIL_MOVE_TASK_NO_SUCH_ACTIVITY "no such activity\n"
+#define STR_FAIL_BATCH_INVALID_BATCH_SIZE "invalid batch size\n"
 
 /* Success and failure messages for displaying an activity. */
 #define STR_SUCCESS_DISPLAY_ACTIVITY "%d %u %s\n"
 #define STR_FAIL_DISPLAY_ACTIVITY_NO_SUCH_ACTIVITY "no such activity\n"
 
+/* Success and failure messages for paginated listings. */
+#define STR_SUCCESS_PAGE_CURSOR "cursor %d\n"
+#define STR_FAIL_PAGE_INVALID_PAGE_SIZE "invalid page size\n"
+
 /* Success and failure messages for adding a new activity. */
 #define STR_SUCCESS_LIST_ACTIVITIES "%s\n"
 #define STR_FAIL_NEW_ACTIVITY_DUPLICATE_ACTIVITY "duplicate activity\n"
 #define STR_FAIL_NEW_ACTIVITY_INVALID_DESCRIPTION "invalid description\n"
 #define STR_FAIL_NEW_ACTIVITY_TOO_MANY_ACTIVITIES "too many activities\n"
 
+/* Success and failure messages for subscriptions. */
+#define STR_SUCCESS_SUBSCRIBE "subscriber %d\n"
+#define STR_FAIL_SUBSCRIBE "cannot subscribe\n"
+#define STR_FAIL_SUBSCRIBE_INVALID_RING_SIZE "invalid ring size\n"
+#define STR_FAIL_NO_SUCH_SUBSCRIBER "no such subscriber\n"
+
+/* Changes delivered to subscribers, all start with the sequence number. */
+#define STR_CHANGE_NEW_TASK "%u %s %d %d %s\n"
+#define STR_CHANGE_MOVE_TASK "%u %s %d %s %d %s %d\n"
+#define STR_CHANGE_ADVANCE_TIME "%u %s %u\n"
+#define STR_CHANGE_NEW_USER "%u %s %s\n"
+#define STR_CHANGE_NEW_ACTIVITY "%u %s %d %s\n"
+#define STR_CHANGE_GAP "%u %s %u\n"
+#define STR_CHANGE_KIND_NEW_TASK "task"
+#define STR_CHANGE_KIND_MOVE_TASK "move"
+#define STR_CHANGE_KIND_ADVANCE_TIME "time"
+#define STR_CHANGE_KIND_NEW_USER "user"
+#define STR_CHANGE_KIND_NEW_ACTIVITY "activity"
+#define STR_CHANGE_KIND_GAP "gap"
+/* User of a change to a task that had none. */
+#define STR_NO_USER "-"
+
+/* Success and failure messages for listing the tasks of a user. */
+#define STR_SUCCESS_USER_TASKS "%d %s @%u %s\n"
+#define STR_FAIL_USER_TASKS_NO_SUCH_USER "no such user\n"
+#define STR_FAIL_USER_TASKS "cannot list tasks of user\n"
+
+/* Success and failure messages for querying the past. */
+#define STR_SUCCESS_TASK_AT "%d %s %s\n"
+#define STR_FAIL_HISTORY_EXPIRED "history expired\n"
+
+/* Transitions kept in the history of each task. Tests lower it with -D. */
+#ifndef HISTORY_RETENTION
+#define HISTORY_RETENTION 32
+#endif
+/* Index of a transition that is not in a task's history. */
+#define NO_TRANSITION -1
+
+/* Reports across all boards. */
+#define STR_REPORT_BOARDS "%s %d\n"
+#define STR_REPORT_ACTIVITY "%s %d %s\n"
+#define STR_REPORT_SLACK "%s %d\n"
+#define STR_REPORT_USER "%s %d %s\n"
+#define STR_REPORT_KIND_BOARDS "boards"
+#define STR_REPORT_KIND_ACTIVITY "activity"
+#define STR_REPORT_KIND_SLACK "slack"
+#define STR_REPORT_KIND_USER "user"
+#define STR_FAIL_REPORT "cannot report\n"
+/* Threads scanning boards for reports. */
+#define REPORT_THREADS 4
+/* Users listed in a report. */
+#define REPORT_TOP_USERS 10
+#define REPORT_INITIAL_SLOTS 16
+/* Size of a name in a report, fits users and activities. */
+#define COUNT_NAME_SZ 21
+
+/* Key kernel micro-benchmark, only used in builds with -DBENCH. */
+#define BENCH_KERNELS 3
+#define BENCH_SCALAR "scalar"
+#define BENCH_SSE2 "sse2"
+#define BENCH_AVX2 "avx2"
+#define BENCH_FIND_KEY "find_key"
+#define BENCH_HAS_LOWERCASE "has_lowercase"
+#define BENCH_FIND_USER "find_user"
+#define BENCH_HASH "hash"
+#define STR_BENCH_KEY "user%d"
+#define STR_SUCCESS_BENCH "%s %s %d %u\n"
+#define STR_FAIL_BENCH "invalid benchmark\n"
+
+/* Kinds of changes. */
+#define CHANGE_NEW_TASK 0
+#define CHANGE_MOVE_TASK 1
+#define CHANGE_ADVANCE_TIME 2
+#define CHANGE_NEW_USER 3
+#define CHANGE_NEW_ACTIVITY 4
+
+/* Maximum amount of changes kept for a subscriber. */
+#define MAX_RING_SZ 65536
+#define SUBSCRIBERS_INITIAL_SZ 4
+
+/* Failure message for a command file that can't be opened. */
+#define STR_FAIL_OPEN_STREAM "%s: cannot open command file\n"
+
+/* Command line argument selecting the binary protocol. */
+#define ARG_BINARY "-b"
+/* Command line argument limiting the amount of users in each board. */
+#define ARG_USER_LIMIT "-u"
+#define STR_FAIL_USER_LIMIT "-u: expected a maximum amount of users\n"
+
+/* Binary protocol frames: 4 byte size header, then at most FRAME_SZ bytes. */
+#define FRAME_HEADER_SZ 4
+#define FRAME_SZ 65536
+/* Maximum size of a binary reply frame, header included. */
+#define REPLY_FRAME_SZ 256
+/* Chunk of consumed memory-mapped contents unmapped, in whole pages. */
+#define MAP_RELEASE_SZ (64L * 1024 * 1024)
+/* Size of an integer field in a binary frame. */
+#define INT_FIELD_SZ 4
+/* Maximum size of a string field in a binary frame, its size takes 1 byte. */
+#define STR_FIELD_SZ 255
+
+/* Status codes replacing the messages above in binary replies. */
+#define STATUS_OK 0
+#define STATUS_END 1
+#define STATUS_TOO_MANY_TASKS 2
+#define STATUS_DUPLICATE_DESCRIPTION 3
+#define STATUS_INVALID_DURATION 4
+#define STATUS_NO_SUCH_TASK 5
+#define STATUS_INVALID_TIME 6
+#define STATUS_USER_ALREADY_EXISTS 7
+#define STATUS_TOO_MANY_USERS 8
+#define STATUS_TASK_ALREADY_STARTED 9
+#define STATUS_NO_SUCH_USER 10
+#define STATUS_NO_SUCH_ACTIVITY 11
+#define STATUS_DUPLICATE_ACTIVITY 12
+#define STATUS_INVALID_DESCRIPTION 13
+#define STATUS_TOO_MANY_ACTIVITIES 14
+#define STATUS_INVALID_PAGE_SIZE 15
+#define STATUS_CANNOT_DUMP_TRACE 16
+#define STATUS_CANNOT_SUBSCRIBE 17
+#define STATUS_INVALID_RING_SIZE 18
+#define STATUS_NO_SUCH_SUBSCRIBER 19
+#define STATUS_HISTORY_EXPIRED 20
+#define STATUS_CANNOT_REPORT 21
+#define STATUS_INVALID_BENCH 22
+#define STATUS_CANNOT_LIST_USER_TASKS 23
+#define STATUS_REPLY_TOO_LONG 24
+#define STATUS_CANNOT_ADD_BOARD 25
+#define STATUS_CANNOT_WAKE_BOARD 26
+#define STATUS_INVALID_BATCH_SIZE 27
+
+/* Tracing, only used in builds with -DTRACE. */
+#define TRACE_RING_SZ 16384
+#define TRACE_MAX_THREADS 64
+#define TRACE_PHASE_BEGIN 'B'
+#define TRACE_PHASE_END 'E'
+#define TRACE_FORMAT_SZ 8
+#define TRACE_PATH_SZ 256
+#define TRACE_FORMAT_JSON "json"
+#define TRACE_FORMAT_PERF "perf"
+#define STR_TRACE_JSON_BEGIN "{\"traceEvents\":[\n"
+#define STR_TRACE_JSON_EVENT "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lu," \
+	"\"pid\":%d,\"tid\":%d,\"args\":{\"arg\":%d}}\n"
+#define STR_TRACE_JSON_END "]}\n"
+#define STR_TRACE_PERF_EVENT "kanban-%d [000] .... %lu.%06lu: " \
+	"tracing_mark_write: %c|%d|%s\n"
+
+/* Success and failure messages for dumping the trace. */
+#define STR_SUCCESS_DUMP_TRACE "%d events\n"
+#define STR_FAIL_DUMP_TRACE "cannot dump trace\n"
+
+/* Board manager. */
+#define NO_BOARD -1
+#define BOARD_DEFAULT "default"
+#define BOARD_NAME_SZ 64
+#define BOARD_DIR_TEMPLATE "/tmp/kanban-boards-XXXXXX"
+#define BOARD_DIR_SZ sizeof(BOARD_DIR_TEMPLATE)
+/* The directory, a slash, an int and ".img". */
+#define BOARD_PATH_SZ (BOARD_DIR_SZ + 16)
+#define STR_BOARD_PATH "%s/%d.img"
+#define BOARD_INITIAL_SLOTS 16
+/* Memory the resident boards may take, in bytes. Tests lower it with -D. */
+#ifndef BOARD_MEMORY_BUDGET
+#define BOARD_MEMORY_BUDGET (256L * 1024 * 1024)
+#endif
+/* Commands a board can go unused before it is hibernated. */
+#ifndef BOARD_IDLE_COMMANDS
+#define BOARD_IDLE_COMMANDS 10000
+#endif
+/* Board states. */
+#define BOARD_RESIDENT 0
+#define BOARD_EVICTING 1
+#define BOARD_HIBERNATED 2
+#define BOARD_STRANDED 3
+
+/* Success message for listing boards. */
+#define STR_SUCCESS_LIST_BOARDS "%s\n"
+
+/* Failure messages for the board manager, the setup one goes to stderr. */
+#define STR_FAIL_SETUP_BOARDS "cannot setup boards\n"
+#define STR_FAIL_ADD_BOARD "%s: cannot add board\n"
+#define STR_FAIL_WAKE_BOARD "%s: cannot load board\n"
+
 /* Match strings for scanf */
-#define STR_MATCH_NEW_TASK "%d%*[ ]%[^\n]"
+/* The description width is TASK_DESCRIPTION_SZ - 1, the rest is skipped. */
+#define STR_MATCH_NEW_TASK "%d%*[ ]%50[^\n]%*[^\n]"
 #define STR_MATCH_SINGLE_TASK_ID "%d"
+#define STR_MATCH_REST_OF_LINE "%*[^\n]"
 #define STR_MATCH_TIME_INCREMENT "%d"
 #define STR_MATCH_NEW_USER "%s"
 #define STR_MATCH_TASK_MOVE "%d%s%*[ ]%[^\n]"
+#define STR_MATCH_BATCH_SIZE "%d"
 #define STR_MATCH_ACTIVITY "%[^\n]"
+#define STR_MATCH_PAGE "%d%d"
+#define STR_MATCH_ACTIVITY_PAGE "%d%d%*[ ]%[^\n]"
+#define STR_MATCH_TRACE "%7s%255s"
+#define STR_MATCH_BOARD "%63s"
+#define STR_MATCH_RING_SIZE "%d"
+#define STR_MATCH_READ_CHANGES "%d%d"
+#define STR_MATCH_SUBSCRIBER "%d"
+#define STR_MATCH_PAST_TIME "%d%*[ ]"
+#define STR_MATCH_TASK_AT "%d%d"
+#define STR_MATCH_BENCH "%d%d"
+#define STR_MATCH_USER_TASKS "%20s"
@@ -9,18 +9,169 @@
  * INCLUDES                                                                   *
  ******************************************************************************/
 
+/* Expose POSIX interfaces (mmap, open_memstream) despite -ansi */
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* SIMD key kernels are only built for x86 with GCC-compatible compilers */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KEY_KERNELS_X86
+#include <immintrin.h>
+#endif
 
 /* Include constant strings and magic numbers */
 #include "constants.h"
 
 
+/******************************************************************************
+ * TRACING MACROS                                                             *
+ ******************************************************************************/
+
+/*
+ * Trace points are only compiled in when building with -DTRACE.
+ * - TRACE_BEGIN(name): records the start of an event.
+ * - TRACE_END(name, arg): records the end of an event with an integer argument.
+ * - TRACE_CALL(fn, args): calls fn with args inside an event named fn, and
+ *   evaluates to its return value.
+ */
+#ifdef TRACE
+#define TRACE_BEGIN(name) trace_event(name, TRACE_PHASE_BEGIN, 0)
+#define TRACE_END(name, arg) trace_event(name, TRACE_PHASE_END, arg)
+#define TRACE_CALL(fn, args) (TRACE_BEGIN(#fn), trace_result(#fn, fn args))
+#else
+#define TRACE_BEGIN(name)
+#define TRACE_END(name, arg)
+#define TRACE_CALL(fn, args) (fn args)
+#endif
+
+
+/******************************************************************************
+ * KEY MACROS                                                                 *
+ ******************************************************************************/
+
+/*
+ * Key tables are aligned to KEY_SZ so each key is a single aligned load.
+ * - KEY_ALIGNED: aligns a table of keys.
+ * - KEY_TARGET(isa): compiles a kernel for an instruction set that may not
+ *   be enabled for the rest of the program.
+ */
+#ifdef KEY_KERNELS_X86
+#define KEY_ALIGNED __attribute__((aligned(KEY_SZ)))
+#define KEY_TARGET(isa) __attribute__((target(isa)))
+#else
+#define KEY_ALIGNED
+#endif
+
+
 /******************************************************************************
  * STRUCTS                                                                    *
  ******************************************************************************/
 
+/*
+ * RESULT CACHE
+ * Keeps the already formatted reply to a listing command.
+ * - FIELDS:
+ *   - version: version of the listed data the reply was formatted from.
+ *   - bytes: formatted reply, NULL if there is none.
+ *   - sz: size of the formatted reply.
+ */
+typedef struct {
+	unsigned long version;
+	char *bytes;
+	size_t sz;
+} ResultCache;
+
+/*
+ * STREAM
+ * Keeps track of where the commands are read from and replies written to.
+ * - FIELDS:
+ *   - in: stream the commands are read from.
+ *   - out: stream the replies are written to.
+ *   - map: contents of a binary command file if memory-mapped, NULL
+ *     otherwise.
+ *   - map_sz: size of the memory-mapped contents.
+ *   - released: size of the consumed start of the contents, already unmapped.
+ *   - binary: true if the stream uses the binary protocol instead of text.
+ *   - pos: position of the next binary frame in the memory-mapped contents.
+ *   - frame: payload of the binary frame being handled.
+ *   - frame_sz: size of the frame payload.
+ *   - frame_pos: position of the next field to decode in the frame payload.
+ *   - buffer[]: storage for frames that are not memory-mapped.
+ */
+typedef struct {
+	FILE *in;
+	FILE *out;
+	const char *map;
+	size_t map_sz;
+	size_t released;
+	int binary;
+	size_t pos;
+	const unsigned char *frame;
+	unsigned long frame_sz;
+	unsigned long frame_pos;
+	unsigned char buffer[FRAME_SZ];
+} Stream;
+
+#ifdef TRACE
+/*
+ * TRACE EVENT
+ * Represents the start or end of a traced event.
+ * - FIELDS:
+ *   - name: name of the event.
+ *   - phase: TRACE_PHASE_BEGIN or TRACE_PHASE_END.
+ *   - arg: integer argument of the event.
+ *   - ts: moment of the event, in microseconds.
+ */
+typedef struct {
+	const char *name;
+	char phase;
+	int arg;
+	unsigned long ts;
+} TraceEvent;
+
+/*
+ * TRACE RING
+ * Keeps the latest events of a thread. Only the owning thread writes to it,
+ * so it needs no locking.
+ * - FIELDS:
+ *   - event[]: ring buffer of events.
+ *   - amount: amount of events ever recorded, the latest are kept.
+ *   - tid: id of the owning thread in the trace.
+ */
+typedef struct {
+	TraceEvent event[TRACE_RING_SZ];
+	unsigned long amount;
+	int tid;
+} TraceRing;
+#endif
+
+/*
+ * TRANSITION
+ * Represents a task entering an activity.
+ * - FIELDS:
+ *   - time: moment of the transition.
+ *   - activity: index of the activity entered.
+ *   - user: index of the user that owns the task from then on, NO_USER if
+ *     none does.
+ */
+typedef struct {
+	unsigned int time;
+	int activity;
+	int user;
+} Transition;
+
 /*
  * TASK
  * Represents a task in the kanban.
@@ -30,6 +181,10 @@
  *   - activity that the task is in.
  *   - expected duration of the task.
  *   - moment task was started.
+ *   - moment task was last moved to DONE.
+ *   - history: latest transitions of the task, oldest first. Only the last
+ *     HISTORY_RETENTION are kept.
+ *   - history_sz: amount of transitions in the history.
  */
 typedef struct {
 	char description[TASK_DESCRIPTION_SZ];
@@ -37,30 +192,66 @@ typedef struct {
 	char activity[ACTIVITY_SZ];
 	int duration;
 	unsigned int start;
+	unsigned int finish;
+	Transition *history;
+	int history_sz;
 } Task;
 
+/*
+ * USER TASKS
+ * Index of the tasks assigned to a user.
+ * - FIELDS:
+ *   - order[]: vector of task indices ordered by start time, then
+ *     description.
+ *   - amount: amount of tasks in the index, NO_INDEX if the index was lost
+ *     for lack of memory.
+ *   - capacity: size of the order vector.
+ */
+typedef struct {
+	int *order;
+	int amount;
+	int capacity;
+} UserTasks;
+
 /*
  * USER LIST
- * Keeps track of all users in the kanban.
+ * Keeps track of all users in the kanban, growing as users are added.
  * - FIELDS:
- *   - user[]: list of all user strings in the kanban.
+ *   - user[]: list of all user strings in the kanban, as keys, in the order
+ *     they were added. Aligned to KEY_SZ.
  *   - amount: amount of users in the list.
+ *   - capacity: size of the user vector.
+ *   - slot[]: hash table of user indices by key, NO_USER if empty.
+ *   - amount_slots: size of the hash table, a power of two.
+ *   - limit: maximum amount of users, NO_LIMIT if there's none.
+ *   - tasks[]: index of the tasks assigned to each user.
+ *   - heap_sz: bytes of heap memory taken by the list and its task indices.
  */
 typedef struct {
-	char user[AMT_USERS][USER_SZ];
+	char (*user)[KEY_SZ];
 	int amount;
+	int capacity;
+	UserTasks *tasks;
+	int *slot;
+	int amount_slots;
+	int limit;
+	size_t heap_sz;
 } UserList;
 
 /*
  * ACTIVITY LIST
  * Keeps track of all activities in the kanban.
  * - FIELDS:
- *   - activity[]: list of all activity strings in the kanban.
+ *   - activity[]: list of all activity strings in the kanban, as keys.
  *   - amount: amount of activities in the list.
+ *   - version[]: version of each activity's tasks, bumped when they change.
+ *   - cache[]: reply to displaying each activity.
  */
 typedef struct {
-	char activity[AMT_ACTIVITIES][ACTIVITY_SZ];
+	char activity[AMT_ACTIVITIES][KEY_SZ] KEY_ALIGNED;
 	int amount;
+	unsigned long version[AMT_ACTIVITIES];
+	ResultCache cache[AMT_ACTIVITIES];
 } ActivityList;
 
 /*
@@ -69,20 +260,91 @@ typedef struct {
  * - FIELDS:
  *   - task[]: list of all tasks in the kanban.
  *   - ordered_by_description[]: vector of task indices ordered by description.
+ *     Only ordered up to amount_sorted, see sort_descriptions().
  *   - amount: amount of tasks in the list.
- *   - ordered_by_start[]: vector of task indices ordered by start time.
+ *   - amount_sorted: amount of indices at the start of ordered_by_description
+ *     that are ordered, the indices after them are of new tasks, by id.
+ *   - ordered_by_start[]: vector of task indices ordered by start time, then
+ *     description.
  *   - first_at_current_time: index of first task to be started after time was advanced.
  *   - amount_started: amount of task in the list that have been started.
+ *   - version: version of the tasks, bumped when any of them changes.
+ *   - cache: reply to listing all tasks.
+ *   - history_horizon: earliest moment the history of every task is kept
+ *     for.
+ *   - heap_sz: bytes of heap memory taken by the task histories.
  */
 typedef struct {
 	Task task[AMT_TASKS];
 	int ordered_by_description[AMT_TASKS];
 	int amount;
+	int amount_sorted;
 	int ordered_by_start[AMT_TASKS];
 	int first_at_current_time;
 	int amount_started;
+	unsigned long version;
+	ResultCache cache;
+	unsigned int history_horizon;
+	size_t heap_sz;
 } TaskList;
 
+/*
+ * CHANGE
+ * Represents a change to the kanban, as delivered to subscribers.
+ * - FIELDS:
+ *   - seq: sequence number of the change in its kanban, starting at 1.
+ *   - kind: CHANGE_NEW_TASK, CHANGE_MOVE_TASK, CHANGE_ADVANCE_TIME,
+ *     CHANGE_NEW_USER or CHANGE_NEW_ACTIVITY.
+ *   - id: id of the task created or moved.
+ *   - from_user, from_activity: indices of the user and activity of a task
+ *     before it was moved, from_user is NO_USER if it had none.
+ *   - to_user, to_activity: indices of the user and activity of a task after
+ *     it was moved, or of the user or activity added.
+ *   - now: current time after time was advanced.
+ */
+typedef struct {
+	unsigned int seq;
+	int kind;
+	int id;
+	int from_user;
+	int from_activity;
+	int to_user;
+	int to_activity;
+	unsigned int now;
+} Change;
+
+/*
+ * SUBSCRIBER
+ * Receives the changes to a kanban in a bounded ring. When the ring is full
+ * the oldest change is overwritten, so a slow subscriber sees a gap in the
+ * sequence numbers instead of blocking the commands that make changes.
+ * - FIELDS:
+ *   - change[]: ring of the latest changes, indexed by sequence number.
+ *   - ring_sz: size of the ring.
+ *   - next: sequence number of the next change to deliver.
+ */
+typedef struct {
+	Change *change;
+	int ring_sz;
+	unsigned int next;
+} Subscriber;
+
+/*
+ * SUBSCRIBER LIST
+ * Keeps track of the subscribers of a kanban.
+ * - FIELDS:
+ *   - subscriber[]: list of all subscribers, by id.
+ *   - amount: amount of subscribers ever added.
+ *   - capacity: size of the subscriber vector.
+ *   - seq: sequence number of the latest change.
+ */
+typedef struct {
+	Subscriber *subscriber;
+	int amount;
+	int capacity;
+	unsigned int seq;
+} SubscriberList;
+
 /*
  * KANBAN
  * Keeps track of the global state of the kanban.
@@ -91,54 +353,315 @@ typedef struct {
  *   - users: user list.
  *   - activities: activity list.
  *   - tasks: task list.
+ *   - subscribers: pointer to the subscriber list, NULL if the kanban can't
+ *     have subscribers. It's kept by the board manager, so that it survives
+ *     hibernation.
  */
 typedef struct {
 	unsigned int now;
 	UserList users;
 	ActivityList activities;
 	TaskList tasks;
+	SubscriberList *subscribers;
 } Kanban;
 
+/*
+ * COUNT
+ * Counts something about a user or activity in a report.
+ * - FIELDS:
+ *   - name: name of the user or activity, empty if the slot is free.
+ *   - amount: the count.
+ */
+typedef struct {
+	char name[COUNT_NAME_SZ];
+	int amount;
+} Count;
+
+/*
+ * TALLY
+ * Hash table of counts by name.
+ * - FIELDS:
+ *   - slot[]: the counts.
+ *   - amount: amount of slots in use.
+ *   - amount_slots: size of the hash table, a power of two.
+ */
+typedef struct {
+	Count *slot;
+	int amount;
+	int amount_slots;
+} Tally;
+
+/*
+ * REPORT
+ * Aggregates of a set of boards.
+ * - FIELDS:
+ *   - boards: amount of boards scanned.
+ *   - slack: total slack of the tasks in DONE.
+ *   - activities: amount of tasks in each activity.
+ *   - users: amount of started tasks not yet done of each user.
+ *   - failed: true if a board couldn't be scanned or there was no memory.
+ */
+typedef struct {
+	int boards;
+	int slack;
+	Tally activities;
+	Tally users;
+	int failed;
+} Report;
+
+/*
+ * BOARD
+ * Represents a kanban hosted by the board manager.
+ * - FIELDS:
+ *   - name: name of the board.
+ *   - k: pointer to the board's Kanban, NULL while it is hibernated.
+ *   - state: BOARD_RESIDENT, BOARD_EVICTING, BOARD_HIBERNATED or
+ *     BOARD_STRANDED (still in memory because its eviction failed).
+ *   - last_used: manager clock when the board last ran a command.
+ *   - newer, older: neighbours in the list of resident boards, by last use.
+ *   - bytes: memory the board took when last accounted for, while resident.
+ *   - next_evicting: next board waiting to be evicted.
+ *   - subscribers: subscriber list of the board.
+ */
+typedef struct {
+	char name[BOARD_NAME_SZ];
+	Kanban *k;
+	SubscriberList *subscribers;
+	int state;
+	unsigned long last_used;
+	int newer;
+	int older;
+	size_t bytes;
+	int next_evicting;
+} Board;
+
+/*
+ * BOARD MANAGER
+ * Keeps track of every board, hibernating idle ones to disk on a background
+ * thread so that the resident ones fit in the memory budget.
+ * - FIELDS:
+ *   - board[]: list of all boards, in creation order.
+ *   - amount: amount of boards.
+ *   - capacity: size of the board vector.
+ *   - slot[]: hash table of board indices by name, NO_BOARD if empty.
+ *   - amount_slots: size of the hash table, a power of two.
+ *   - current: index of the board commands are run on.
+ *   - clock: amount of commands run, tells how long boards have been idle.
+ *   - newest, oldest: ends of the list of resident boards, by last use.
+ *   - resident_bytes: memory taken by the resident boards, in bytes.
+ *   - evicting: first board waiting to be evicted, NO_BOARD if none.
+ *   - dir: directory where hibernated boards are stored.
+ *   - stopping: true when the eviction thread should finish.
+ *   - lock: protects board states, Kanban pointers and the eviction queue.
+ *   - work: signaled when there are boards to evict or the thread must stop.
+ *   - done: signaled when a board has been evicted.
+ *   - evictor: thread that evicts boards.
+ *   - reporter[]: threads that scan boards for reports.
+ *   - report[]: partial report of each reporter thread.
+ *   - amount_reporters: amount of reporter threads started.
+ *   - report_ids: amount of reporter threads that picked their partial.
+ *   - report_round: bumped to start a report.
+ *   - report_next: next board to be scanned.
+ *   - report_pending: amount of reporter threads still scanning.
+ *   - report_work: signaled when a report starts or the threads must stop.
+ *   - report_done: signaled when the last reporter thread is done.
+ *   - user_limit: maximum amount of users in each board, NO_LIMIT if none.
+ */
+typedef struct {
+	Board *board;
+	int amount;
+	int capacity;
+	int *slot;
+	int amount_slots;
+	int current;
+	unsigned long clock;
+	int newest;
+	int oldest;
+	size_t resident_bytes;
+	int evicting;
+	char dir[BOARD_DIR_SZ];
+	int stopping;
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t done;
+	pthread_t evictor;
+	pthread_t reporter[REPORT_THREADS];
+	Report report[REPORT_THREADS];
+	int amount_reporters;
+	int report_ids;
+	unsigned long report_round;
+	int report_next;
+	int report_pending;
+	pthread_cond_t report_work;
+	pthread_cond_t report_done;
+	int user_limit;
+} BoardManager;
+
 
 /******************************************************************************
  * FUNCTION PROTOTYPES                                                        *
  ******************************************************************************/
 
 void setup(Kanban *k);
-int select(Kanban *k, char cmd_code, int has_args);
-
-int new_task(TaskList *l);
-int list_tasks(TaskList *l, int has_args);
-int advance_time(Kanban *k);
-int handle_users(UserList *l, int has_args);
-int new_user(UserList *l);
-int list_users(UserList *l);
-int move_task(Kanban *k);
-int display_activity(Kanban *k);
-int handle_activities(ActivityList *l, int has_args);
-int new_activity(ActivityList *l);
-int list_activities(ActivityList *l);
-
-int is_new_task_valid(TaskList *l, Task *t);
-int is_id_valid(TaskList *l, int id);
-int is_time_valid(int time);
-int is_new_user_valid(UserList *l, char user[]);
-int is_move_valid(Kanban *k, int id, char user[], char activity[]);
-int is_activity_valid(ActivityList *l, char activity[]);
-int is_new_activity_valid(ActivityList *l, char activity[]);
+Kanban *alloc_kanban(void);
+void setup_caches(Kanban *k);
+void free_caches(Kanban *k);
+void free_history(TaskList *l);
+size_t board_bytes(Kanban *k);
+void setup_users(UserList *l);
+void free_users(UserList *l);
+int run_command(Stream *s, BoardManager *m, char cmd_code, int has_args);
+int select(Stream *s, Kanban *k, char cmd_code, int has_args);
+
+void setup_key_kernels(void);
+void to_key(char key[], const char s[]);
+int find_key_scalar(const char table[][KEY_SZ], int amount, const char key[]);
+int has_lowercase_scalar(const char key[]);
+#ifdef KEY_KERNELS_X86
+int find_key_sse2(const char table[][KEY_SZ], int amount, const char key[]);
+int has_lowercase_sse2(const char key[]);
+int find_key_avx2(const char table[][KEY_SZ], int amount, const char key[]);
+int has_lowercase_avx2(const char key[]);
+#endif
+#ifdef BENCH
+int bench_keys(Stream *s);
+unsigned int bench_ns(struct timespec *start, struct timespec *end, int calls);
+#endif
+
+int open_stream(Stream *s, char path[], int binary);
+void close_stream(Stream *s);
+int read_command(Stream *s, int *cmd_code, int *has_args);
+int read_frame(Stream *s);
+void read_description(Stream *s, Task *t);
+int decode_int(Stream *s, int *x);
+int decode_str(Stream *s, const char **str, int *sz);
+int decode_word(Stream *s, char word[], int word_sz);
+void reply(Stream *s, int status, const char *fmt, ...);
+void encode_reply(Stream *s, int status, const char *fmt, va_list ap);
+void end_reply(Stream *s);
+int replay_cache(Stream *s, ResultCache *c, unsigned long version);
+FILE *begin_cache(Stream *s, ResultCache *c);
+void end_cache(Stream *s, ResultCache *c, FILE *out, unsigned long version);
+unsigned long get_u32(const unsigned char bytes[]);
+void put_u32(unsigned char bytes[], unsigned long x);
+
+int setup_boards(BoardManager *m, int user_limit);
+void close_boards(BoardManager *m);
+int switch_board(Stream *s, BoardManager *m, int has_args);
+int list_boards(Stream *s, BoardManager *m);
+Kanban *wake_board(BoardManager *m);
+void hibernate_idle_boards(BoardManager *m);
+void *evict_boards(void *arg);
+int find_board(BoardManager *m, char name[]);
+int add_board(BoardManager *m, char name[]);
+void index_board(BoardManager *m, int i);
+void push_resident(BoardManager *m, int i);
+void unlink_resident(BoardManager *m, int i);
+void account_board(BoardManager *m, int i);
+void board_path(BoardManager *m, int i, char path[]);
+int save_board(Kanban *k, char path[]);
+int load_board(Kanban *k, char path[]);
+unsigned long hash_str(const char s[]);
+
+void publish(Kanban *k, Change *c);
+void print_change(Stream *s, Kanban *k, Change *c);
+void free_subscribers(SubscriberList *l);
+
+int report(Stream *s, BoardManager *m);
+void *scan_boards(void *arg);
+void scan_board(Kanban *k, Report *r);
+void setup_report(Report *r);
+void free_report(Report *r);
+void merge_report(Report *into, Report *from);
+void print_report(Stream *s, Report *r);
+void add_count(Report *r, Tally *t, const char name[], int amount);
+int compare_counts_by_name(const void *a, const void *b);
+int compare_counts_by_amount(const void *a, const void *b);
+
+int new_task(Stream *s, Kanban *k);
+int list_tasks(Stream *s, TaskList *l, int has_args);
+int advance_time(Stream *s, Kanban *k);
+int handle_users(Stream *s, Kanban *k, int has_args);
+int new_user(Stream *s, Kanban *k);
+int list_users(Stream *s, UserList *l);
+int move_task(Stream *s, Kanban *k);
+int batch_move_tasks(Stream *s, Kanban *k, int has_args);
+int display_activity(Stream *s, Kanban *k);
+int list_tasks_page(Stream *s, TaskList *l);
+int display_activity_page(Stream *s, Kanban *k);
+int handle_activities(Stream *s, Kanban *k, int has_args);
+int new_activity(Stream *s, Kanban *k);
+int list_activities(Stream *s, ActivityList *l);
+int subscribe(Stream *s, Kanban *k);
+int read_changes(Stream *s, Kanban *k);
+int unsubscribe(Stream *s, Kanban *k);
+int display_activity_at(Stream *s, Kanban *k);
+int task_at(Stream *s, Kanban *k);
+int list_user_tasks(Stream *s, Kanban *k);
+
+void relocate_task(Stream *s, Kanban *k, int id, char user[], char activity[]);
+void touch_activity(Kanban *k, char activity[]);
+int read_move(Stream *s, int *id, char user[], char activity[]);
+void read_activity(Stream *s, char activity[]);
+
+int is_new_task_valid(Stream *s, TaskList *l, Task *t);
+int is_id_valid(Stream *s, TaskList *l, int id);
+int is_time_valid(Stream *s, int time);
+int is_new_user_valid(Stream *s, UserList *l, char user[]);
+int is_move_valid(Stream *s, Kanban *k, int id, char user[], char activity[]);
+int is_activity_valid(Stream *s, ActivityList *l, char activity[]);
+int is_new_activity_valid(Stream *s, ActivityList *l, char activity[]);
+int is_page_valid(Stream *s, TaskList *l, int page_sz, int cursor);
+int is_batch_size_valid(Stream *s, int amount);
+int is_ring_size_valid(Stream *s, Kanban *k, int ring_sz);
+int is_subscriber_valid(Stream *s, Kanban *k, int id);
+int is_past_time_valid(Stream *s, Kanban *k, int time);
+int is_user_tasks_valid(Stream *s, Kanban *k, char user[]);
 
 int is_task_description_duplicate(TaskList *l, Task *t);
+int compare_descriptions(Task *a, Task *b);
+int compare_starts(Task *a, Task *b);
 int is_existing_user(UserList *l, char user[]);
+int find_user(UserList *l, char user[]);
 int is_existing_activity(ActivityList *l, char activity[]);
+int find_activity(ActivityList *l, char activity[]);
+int find_transition(Task *t, unsigned int time);
+int find_state(Kanban *k, Task *t, unsigned int time, Transition *state);
 int str_has_lowercase(char s[]);
 
-void print_task(TaskList *l, int id);
-void print_activity(Kanban *k, char activity[], int order[], int sz);
+void print_task(Stream *s, TaskList *l, int id);
+void print_activity(Stream *s, Kanban *k, char activity[], int order[],
+					int sz);
+int print_activity_page(Stream *s, Kanban *k, char activity[], int order[],
+						int sz, int i, int page_sz);
+void print_activity_at(Stream *s, Kanban *k, int activity, int order[],
+					   int sz, unsigned int time);
 
+int binary_search(TaskList *l, int order[], int id, int start, int end,
+				  int (*compare)(Task *, Task *));
 void binary_insert(TaskList *l, int order[], int id, int start, int end);
-void append_user(UserList *l, char new_user[]);
+void merge_insert(TaskList *l, int order[], int ids[], int sz,
+				  int start, int end);
+void merge_sort(TaskList *l, int ids[], int tmp[], int sz);
+void sort_descriptions(TaskList *l);
+int append_user(UserList *l, char new_user[]);
+int grow_users(UserList *l);
+void index_user(UserList *l, int i);
+void assign_task(UserList *l, TaskList *tasks, int user, int id);
+void unassign_task(UserList *l, TaskList *tasks, int user, int id);
+int rebuild_user_tasks(UserList *l, TaskList *tasks, int user);
 void append_activity(ActivityList *l, char new_activity[]);
 void append_task(TaskList *l, Task *new_task);
+void append_transition(TaskList *l, Task *t, unsigned int time,
+					   int activity, int user);
+
+#ifdef TRACE
+int dump_trace(Stream *s);
+const char *command_name(char cmd_code);
+void trace_event(const char *name, char phase, int arg);
+int trace_result(const char *name, int result);
+TraceRing *trace_ring(void);
+#endif
 
 
 /******************************************************************************
@@ -147,30 +670,65 @@ void append_task(TaskList *l, Task *new_task);
 
 /*
  * MAIN FUNCTION
- * Setups the Kanban and runs the loop until the user requests to stop.
+ * Setups the Kanban and runs the loop until the user requests to stop or the
+ * commands run out. Usage: kanban [-b] [-u <max users>] [<command file>]
+ * Commands are read from the command file, or from stdin if there is none,
+ * using the binary protocol if -b is given. Boards take any amount of users
+ * unless -u is given.
  *
- * ARGS: none.
+ * ARGS:
+ *     - int argc: amount of command line arguments.
+ *     - char *argv[]: command line arguments.
  * RETURN (int):
  *     - exit code, EXIT_OK on success.
  */
-int main()
+int main(int argc, char *argv[])
 {
-	int has_args, status = KEEP_GOING;
-	char cmd_code;
+	int i, has_args, cmd_code, binary = 0, status = KEEP_GOING;
+	int user_limit = NO_LIMIT;
+	long limit;
+	char *path = NULL, *end;
+
+	Stream stream;
+	BoardManager boards;
 
-	Kanban kanban;
+	setup_key_kernels();
 
-	setup(&kanban);
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], ARG_BINARY) == EQUAL)
+			binary = 1;
+		else if (strcmp(argv[i], ARG_USER_LIMIT) == EQUAL) {
+			if (++i == argc || !isdigit((unsigned char) argv[i][0]) ||
+				(limit = strtol(argv[i], &end, 10)) > INT_MAX ||
+				*end != '\0') {
+				fprintf(stderr, STR_FAIL_USER_LIMIT);
+				return EXIT_ERROR;
+			}
+			user_limit = (int) limit;
+		} else
+			path = argv[i];
+	}
 
-	while (status == KEEP_GOING) {
-		cmd_code = getchar();
+	if (!open_stream(&stream, path, binary)) {
+		fprintf(stderr, STR_FAIL_OPEN_STREAM, path);
+		return EXIT_ERROR;
+	}
 
-		if ('\n' != cmd_code) {
-			has_args = ('\n' != getchar());
-			status = select(&kanban, cmd_code, has_args);
-		}
+	if (!setup_boards(&boards, user_limit)) {
+		fprintf(stderr, STR_FAIL_SETUP_BOARDS);
+		close_stream(&stream);
+		return EXIT_ERROR;
+	}
+
+	while (status == KEEP_GOING &&
+		   read_command(&stream, &cmd_code, &has_args)) {
+		status = run_command(&stream, &boards, cmd_code, has_args);
+		end_reply(&stream);
 	}
 
+	close_boards(&boards);
+	close_stream(&stream);
+
 	return EXIT_OK;
 }
 
@@ -186,651 +744,3746 @@ void setup(Kanban *k)
 {
 	k->now = 0;
 
-	k->users.amount = 0;
+	setup_users(&k->users);
 	k->activities.amount = 0;
 	k->tasks.amount = 0;
+	k->tasks.amount_sorted = 0;
 	k->tasks.amount_started = 0;
 	k->tasks.first_at_current_time = 0;
+	k->tasks.history_horizon = 0;
+	k->tasks.heap_sz = 0;
+	k->subscribers = NULL;
 
 	append_activity(&k->activities, STR_TO_DO);
 	append_activity(&k->activities, STR_IN_PROGRESS);
 	append_activity(&k->activities, STR_DONE);
+
+	setup_caches(k);
 }
 
 /*
- * SELECTION FUNCTION
- * Based on the command picks the approprite command handling function.
+ * ALLOCATE KANBAN
+ * Allocates memory for a Kanban, aligned for its key tables.
  *
- * ARGS:
- *     - Kanban *k: pointer to Kanban.
- *     - char cmd_code: command character, the first character in user input.
- *     - char has_args: true if the user input has further arguments.
- * RETURN (int):
- *     - continues the infinite loop if KEEP_GOING.
+ * RETURN (Kanban *):
+ *     - pointer to the uninitialized Kanban, NULL if there's no memory.
  */
-int select(Kanban *k, char cmd_code, int has_args)
+Kanban *alloc_kanban(void)
 {
-	switch (cmd_code) {
-		case 'q':
-			return STOP;
-		case 't':
-			return new_task(&k->tasks);
-		case 'l':
-			return list_tasks(&k->tasks, has_args);
-		case 'n':
-			return advance_time(k);
-		case 'u':
-			return handle_users(&k->users, has_args);
-		case 'm':
-			return move_task(k);
-		case 'd':
-			return display_activity(k);
-		case 'a':
-			return handle_activities(&k->activities, has_args);
-		default:
-			return KEEP_GOING;
-	}
-}
+	void *k;
 
+	if (posix_memalign(&k, KEY_SZ, sizeof(Kanban)) != 0)
+		return NULL;
 
-/******************************************************************************
- * COMMAND HANDLING FUNCTIONS                                                 *
- ******************************************************************************/
+	return k;
+}
 
 /*
- * NEW TASK HANDLING
- * Related command: t <duration> <descritption>
- * Adds a new task to the kanban.
+ * SETUP CACHES
+ * Empties the listing caches of a Kanban, without releasing them.
  *
  * ARGS:
- *     - TaskList *l: pointer to the Kanban's task list.
- * RETURN (int):
- *     - continues the infinite loop if KEEP_GOING.
+ *     - Kanban *k: pointer to Kanban.
+ * RETURN (void).
  */
-int new_task(TaskList *l)
+void setup_caches(Kanban *k)
 {
-	Task t;
-
-	scanf(STR_MATCH_NEW_TASK, &t.duration, t.description);
-	strcpy(t.activity, STR_TO_DO);
-	t.start = 0;
+	int i;
 
-	if (is_new_task_valid(l, &t)) {
-		append_task(l, &t);
-		binary_insert(l, l->ordered_by_description, l->amount,
-					  0, l->amount - 2);
+	k->tasks.version = 1;
+	k->tasks.cache.bytes = NULL;
 
-		printf(STR_SUCCESS_NEW_TASK, l->amount);
+	for (i = 0; i < AMT_ACTIVITIES; i++) {
+		k->activities.version[i] = 1;
+		k->activities.cache[i].bytes = NULL;
 	}
-
-	return KEEP_GOING;
 }
 
 /*
- * LIST TASKS HANDLING
- * Related command: l [<id> <id> ...]
- * Lists tasks in kanban.
+ * FREE CACHES
+ * Releases the listing caches of a Kanban.
  *
  * ARGS:
- *     - TaskList *l: pointer to the Kanban's task list.
- * RETURN (int):
- *     - continues the infinite loop if KEEP_GOING.
+ *     - Kanban *k: pointer to Kanban.
+ * RETURN (void).
  */
-int list_tasks(TaskList *l, int has_args)
+void free_caches(Kanban *k)
 {
-	int i, id;
+	int i;
 
-	if (has_args) {
-		while (scanf(STR_MATCH_SINGLE_TASK_ID, &id) != 0) {
-			if (is_id_valid(l, id))
-				print_task(l, id);
-		}
-	} else {
-		for (i = 0; i < l->amount; i++) {
-			id = l->ordered_by_description[i] + 1;
-			if (is_id_valid(l, id))
-				print_task(l, id);
-		}
-	}
+	free(k->tasks.cache.bytes);
 
-	return KEEP_GOING;
+	for (i = 0; i < AMT_ACTIVITIES; i++)
+		free(k->activities.cache[i].bytes);
 }
 
 /*
- * ADVANCE TIME HANDLING
- * Related command: n <duration>
- * Advance the kanban's current time.
+ * FREE HISTORY
+ * Releases the history of every task.
  *
  * ARGS:
- *     - Kanban *k: pointer to Kanban.
- * RETURN (int):
- *     - continues the infinite loop if KEEP_GOING.
+ *     - TaskList *l: pointer to the Kanban's task list.
+ * RETURN (void).
  */
-int advance_time(Kanban *k)
+void free_history(TaskList *l)
 {
-	int time;
-	scanf(STR_MATCH_TIME_INCREMENT, &time);
-
-	if (is_time_valid(time)) {
-		k->now += time;
-		k->tasks.first_at_current_time = k->tasks.amount_started;
-		printf(STR_SUCCESS_ADVANCE_TIME, k->now);
-	}
+	int i;
 
-	return KEEP_GOING;
+	for (i = 0; i < l->amount; i++)
+		free(l->task[i].history);
 }
 
 /*
- * USER HANDLING
- * Related command: u [<user>]
- * Handles the user command.
+ * BOARD BYTES
+ * Adds up the memory taken by a Kanban, including its histories, user
+ * tables, task indices and cached replies.
  *
  * ARGS:
- *     - UserList *l: pointer to the Kanban's user list.
- *     - char has_args: true if the user input has further arguments.
- * RETURN (int):
- *     - continues the infinite loop if KEEP_GOING.
+ *     - Kanban *k: pointer to Kanban.
+ * RETURN (size_t):
+ *     - the memory taken, in bytes.
  */
-int handle_users(UserList *l, int has_args)
+size_t board_bytes(Kanban *k)
 {
-	if (has_args)
-		return new_user(l);
-	else
-		return list_users(l);
+	int i;
+	size_t bytes = sizeof(Kanban) + k->users.heap_sz + k->tasks.heap_sz;
+
+	if (k->tasks.cache.bytes != NULL)
+		bytes += k->tasks.cache.sz;
+
+	for (i = 0; i < AMT_ACTIVITIES; i++)
+		if (k->activities.cache[i].bytes != NULL)
+			bytes += k->activities.cache[i].sz;
+
+	return bytes;
 }
 
 /*
- * NEW USER HANDLING
- * Related command: u <user>
- * Adds new user to kanban.
+ * SETUP USERS
+ * Setups an empty user list, with no limit.
  *
  * ARGS:
  *     - UserList *l: pointer to the Kanban's user list.
- * RETURN (int):
- *     - continues the infinite loop if KEEP_GOING.
+ * RETURN (void).
  */
-int new_user(UserList *l)
+void setup_users(UserList *l)
 {
-	char user[USER_SZ];
-	scanf(STR_MATCH_NEW_USER, user);
-
-	if (is_new_user_valid(l, user))
-		append_user(l, user);
-
-	return KEEP_GOING;
+	l->user = NULL;
+	l->amount = 0;
+	l->capacity = 0;
+	l->tasks = NULL;
+	l->slot = NULL;
+	l->amount_slots = 0;
+	l->limit = NO_LIMIT;
+	l->heap_sz = 0;
 }
 
 /*
- * LIST USERS HANDLING
- * Related command: u
- * Lists users in kanban.
+ * FREE USERS
+ * Releases the user list, its hash table and task indices.
  *
  * ARGS:
  *     - UserList *l: pointer to the Kanban's user list.
- * RETURN (int):
- *     - continues the infinite loop if KEEP_GOING.
+ * RETURN (void).
  */
-int list_users(UserList *l)
+void free_users(UserList *l)
 {
 	int i;
 
 	for (i = 0; i < l->amount; i++)
-		printf(STR_SUCCESS_LIST_USERS, l->user[i]);
+		free(l->tasks[i].order);
 
-	return KEEP_GOING;
+	free(l->tasks);
+	free(l->user);
+	free(l->slot);
 }
 
 /*
- * MOVE TASK HANDLING
- * Related command: m <id> <user> <activity>
- * Moves task between activities.
+ * RUN COMMAND
+ * Runs the board manager commands and hands the others to the current board,
+ * waking it up if it was hibernated. If it can't be woken up the command is
+ * skipped and the board stays hibernated. Idle boards are hibernated
+ * afterwards.
  *
  * ARGS:
- *     - Kanban *k: pointer to Kanban.
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - BoardManager *m: pointer to the board manager.
+ *     - char cmd_code: command character, the first character in user input.
+ *     - char has_args: true if the user input has further arguments.
  * RETURN (int):
  *     - continues the infinite loop if KEEP_GOING.
  */
-int move_task(Kanban *k)
+int run_command(Stream *s, BoardManager *m, char cmd_code, int has_args)
 {
-	int id, real_duration, slack;
-	char user[USER_SZ], activity[ACTIVITY_SZ];
-	scanf(STR_MATCH_TASK_MOVE, &id, user, activity);
+	int status;
+	Kanban *k;
 
-	if (is_move_valid(k, id, user, activity)) {
-		if (strcmp(k->tasks.task[id - 1].activity, STR_TO_DO) == EQUAL) {
-			k->tasks.task[id - 1].start = k->now;
-			binary_insert(&k->tasks, k->tasks.ordered_by_start, id,
-						  k->tasks.first_at_current_time,
-						  k->tasks.amount_started - 1);
-			k->tasks.amount_started++;
-		}
-		strcpy(k->tasks.task[id - 1].user, user);
-		strcpy(k->tasks.task[id - 1].activity, activity);
+	m->clock++;
 
-		if (strcmp(activity, STR_DONE) == EQUAL) {
-			real_duration = k->now - k->tasks.task[id - 1].start;
-			slack = real_duration - k->tasks.task[id - 1].duration;
-			printf(STR_SUCCESS_MOVE_TASK_TO_DONE, real_duration, slack);
-		}
+	if ('b' == cmd_code)
+		status = switch_board(s, m, has_args);
+	else if ('R' == cmd_code)
+		status = report(s, m);
+	else if ((k = wake_board(m)) != NULL) {
+		status = select(s, k, cmd_code, has_args);
+		account_board(m, m->current);
+	} else {
+		if (!s->binary && has_args)
+			fscanf(s->in, STR_MATCH_REST_OF_LINE);
+		reply(s, STATUS_CANNOT_WAKE_BOARD, STR_FAIL_WAKE_BOARD,
+			  m->board[m->current].name);
+		status = KEEP_GOING;
 	}
 
-	return KEEP_GOING;
+	hibernate_idle_boards(m);
+
+	return status;
 }
 
 /*
- * DISPLAY ACTIVITY HANDLING
- * Related command: d <activity>
- * List all tasks in activity.
+ * SELECTION FUNCTION
+ * Based on the command picks the approprite command handling function.
  *
  * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
  *     - Kanban *k: pointer to Kanban.
+ *     - char cmd_code: command character, the first character in user input.
+ *     - char has_args: true if the user input has further arguments.
  * RETURN (int):
  *     - continues the infinite loop if KEEP_GOING.
  */
-int display_activity(Kanban *k)
+int select(Stream *s, Kanban *k, char cmd_code, int has_args)
 {
-	char activity[ACTIVITY_SZ];
-	scanf(STR_MATCH_ACTIVITY, activity);
+	int status = KEEP_GOING;
 
-	if (is_activity_valid(&k->activities, activity)) {
-		if (strcmp(activity, STR_TO_DO) == EQUAL)
-			print_activity(k, activity,
-						   k->tasks.ordered_by_description, k->tasks.amount);
-		else
-			print_activity(k, activity,
-						   k->tasks.ordered_by_start, k->tasks.amount_started);
+	TRACE_BEGIN(command_name(cmd_code));
+
+	switch (cmd_code) {
+		case 'q':
+			status = STOP;
+			break;
+		case 't':
+			status = new_task(s, k);
+			break;
+		case 'l':
+			status = list_tasks(s, &k->tasks, has_args);
+			break;
+		case 'n':
+			status = advance_time(s, k);
+			break;
+		case 'u':
+			status = handle_users(s, k, has_args);
+			break;
+		case 'm':
+			status = move_task(s, k);
+			break;
+		case 'M':
+			status = batch_move_tasks(s, k, has_args);
+			break;
+		case 'L':
+			status = list_tasks_page(s, &k->tasks);
+			break;
+		case 'd':
+			status = display_activity(s, k);
+			break;
+		case 'D':
+			status = display_activity_page(s, k);
+			break;
+		case 'a':
+			status = handle_activities(s, k, has_args);
+			break;
+		case 's':
+			status = subscribe(s, k);
+			break;
+		case 'e':
+			status = read_changes(s, k);
+			break;
+		case 'x':
+			status = unsubscribe(s, k);
+			break;
+		case 'h':
+			status = display_activity_at(s, k);
+			break;
+		case 'H':
+			status = task_at(s, k);
+			break;
+		case 'w':
+			status = list_user_tasks(s, k);
+			break;
+#ifdef TRACE
+		case 'T':
+			status = dump_trace(s);
+			break;
+#endif
+#ifdef BENCH
+		case 'K':
+			status = bench_keys(s);
+			break;
+#endif
 	}
 
-	return KEEP_GOING;
+	TRACE_END(command_name(cmd_code), cmd_code);
+
+	return status;
 }
 
-/*
- * ACTIVITY HANDLING
- * Related command: a [<activity>]
- * Handles the activity command.
+
+/******************************************************************************
+ * KEY FUNCTIONS                                                              *
+ ******************************************************************************/
+
+/* Kernels picked by setup_key_kernels() for the running CPU. */
+static int (*find_key)(const char table[][KEY_SZ], int amount,
+					   const char key[]) = find_key_scalar;
+static int (*has_lowercase)(const char key[]) = has_lowercase_scalar;
+
+/*
+ * SETUP KEY KERNELS
+ * Picks the fastest key kernels the running CPU supports: AVX2, SSE2 or
+ * scalar.
  *
- * ARGS:
- *     - ActivityList *l: pointer to the Kanban's acitivity list.
- *     - char has_args: true if the user input has further arguments.
- * RETURN (int):
- *     - continues the infinite loop if KEEP_GOING.
+ * RETURN (void).
  */
-int handle_activities(ActivityList *l, int has_args)
+void setup_key_kernels(void)
 {
-	if (has_args)
-		return new_activity(l);
-	else
-		return list_activities(l);
+#ifdef KEY_KERNELS_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		find_key = find_key_avx2;
+		has_lowercase = has_lowercase_avx2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		find_key = find_key_sse2;
+		has_lowercase = has_lowercase_sse2;
+	}
+#endif
 }
 
 /*
- * NEW ACTIVITY HANDLING
- * Related command: a <activity>
- * Adds new activity to kanban.
+ * TO KEY
+ * Copies a string into a key: KEY_SZ bytes, zero padded, so keys can be
+ * compared whole.
  *
  * ARGS:
- *     - ActivityList *l: pointer to the Kanban's activity list.
- * RETURN (int):
- *     - continues the infinite loop if KEEP_GOING.
+ *     - char key[]: where the key is stored, KEY_SZ long.
+ *     - const char s[]: the string.
+ * RETURN (void).
  */
-int new_activity(ActivityList *l)
+void to_key(char key[], const char s[])
 {
-	char activity[ACTIVITY_SZ];
-	scanf(STR_MATCH_ACTIVITY, activity);
-
-	if (is_new_activity_valid(l, activity))
-		append_activity(l, activity);
-
-	return KEEP_GOING;
+	strncpy(key, s, KEY_SZ - 1);
+	key[KEY_SZ - 1] = '\0';
 }
 
 /*
- * LIST ACTIVITIES HANDLING
- * Related command: a
- * Lists activities in kanban.
+ * FIND KEY (SCALAR)
+ * Looks up a key in a table of keys.
  *
  * ARGS:
- *     - ActivityList *l: pointer to the Kanban's activity list.
+ *     - const char table[][KEY_SZ]: the table.
+ *     - int amount: amount of keys in the table.
+ *     - const char key[]: the key.
  * RETURN (int):
- *     - continues the infinite loop if KEEP_GOING.
+ *     - index of the key in the table, NO_KEY if it's not there.
  */
-int list_activities(ActivityList *l)
+int find_key_scalar(const char table[][KEY_SZ], int amount, const char key[])
 {
 	int i;
 
-	for(i = 0; i < l->amount; i++)
-		printf(STR_SUCCESS_LIST_ACTIVITIES, l->activity[i]);
+	for (i = 0; i < amount; i++) {
+		if (memcmp(table[i], key, KEY_SZ) == EQUAL)
+			return i;
+	}
 
-	return KEEP_GOING;
+	return NO_KEY;
 }
 
-
-/******************************************************************************
- * ERROR CHECKING FUNCTIONS                                                   *
- ******************************************************************************/
-
 /*
- * CHECK NEW TASK
- * Checks for the following errors related to the new task command:
- *     - too many tasks.
- *     - duplicate description.
- *     - invalid duration.
+ * HAS LOWERCASE (SCALAR)
+ * Check if a key contains lowercase characters.
  *
  * ARGS:
- *     - TaskList *l: pointer to the Kanban's task list.
- *     - Task *t: pointer to the new task that will be checked.
+ *     - const char key[]: the key.
  * RETURN (int):
- *     - returns 1 if there are no errors, 0 otherwise.
+ *     - returns 1 if the key has any lowercase, 0 otherwise.
  */
-int is_new_task_valid(TaskList *l, Task *t)
+int has_lowercase_scalar(const char key[])
 {
-	if (l->amount >= AMT_TASKS)
-		printf(STR_FAIL_NEW_TASK_TOO_MANY_TASKS);
-	else if (is_task_description_duplicate(l, t))
-		printf(STR_FAIL_NEW_TASK_DUPLICATE_DESCRIPTION);
-	else if (t->duration <= 0)
-		printf(STR_FAIL_NEW_TASK_INVALID_DURATION);
-	else
-		return 1;
+	int i;
+
+	for (i = 0; i < KEY_SZ && key[i] != '\0'; i++) {
+		if (islower((unsigned char) key[i]))
+			return 1;
+	}
 
 	return 0;
 }
 
+#ifdef KEY_KERNELS_X86
 /*
- * CHECK ID
- * Checks for the following errors related to the list tasks command:
- *     - <id>: no such task.
+ * FIND KEY (SSE2)
+ * Looks up a key in a table of keys, comparing each key as two 16 byte
+ * halves.
  *
  * ARGS:
- *     - TaskList *l: pointer to the Kanban's task list.
- *     - int id: id to be checked.
+ *     - const char table[][KEY_SZ]: the table, aligned to KEY_SZ.
+ *     - int amount: amount of keys in the table.
+ *     - const char key[]: the key.
  * RETURN (int):
- *     - returns 1 if there are no errors, 0 otherwise.
+ *     - index of the key in the table, NO_KEY if it's not there.
  */
-int is_id_valid(TaskList *l, int id)
+KEY_TARGET("sse2")
+int find_key_sse2(const char table[][KEY_SZ], int amount, const char key[])
 {
-	if (id < 1 || id > l->amount)
-		printf(STR_FAIL_LIST_TASKS_NO_SUCH_TASK, id);
-	else
-		return 1;
+	int i;
+	__m128i lo = _mm_loadu_si128((const __m128i *) key);
+	__m128i hi = _mm_loadu_si128((const __m128i *) (key + 16));
+	__m128i eq;
 
-	return 0;
+	for (i = 0; i < amount; i++) {
+		eq = _mm_and_si128(
+			_mm_cmpeq_epi8(lo, _mm_load_si128((const __m128i *) table[i])),
+			_mm_cmpeq_epi8(hi, _mm_load_si128((const __m128i *)
+											  (table[i] + 16))));
+		if (_mm_movemask_epi8(eq) == 0xFFFF)
+			return i;
+	}
+
+	return NO_KEY;
 }
 
 /*
- * CHECK TIME
- * Checks for the following errors related to the advance time command:
- *     - invalid time.
+ * HAS LOWERCASE (SSE2)
+ * Check if a key contains lowercase characters, 16 bytes at a time.
  *
  * ARGS:
- *     - int time: time integer to be checked.
+ *     - const char key[]: the key.
  * RETURN (int):
- *     - returns 1 if there are no errors, 0 otherwise.
+ *     - returns 1 if the key has any lowercase, 0 otherwise.
  */
-int is_time_valid(int time)
+KEY_TARGET("sse2")
+int has_lowercase_sse2(const char key[])
 {
-	if (time < 0)
-		printf(STR_FAIL_ADVANCE_TIME_INVALID_TIME);
-	else
-		return 1;
+	__m128i before_a = _mm_set1_epi8('a' - 1);
+	__m128i after_z = _mm_set1_epi8('z' + 1);
+	__m128i lo = _mm_loadu_si128((const __m128i *) key);
+	__m128i hi = _mm_loadu_si128((const __m128i *) (key + 16));
 
-	return 0;
+	lo = _mm_and_si128(_mm_cmpgt_epi8(lo, before_a),
+					   _mm_cmplt_epi8(lo, after_z));
+	hi = _mm_and_si128(_mm_cmpgt_epi8(hi, before_a),
+					   _mm_cmplt_epi8(hi, after_z));
+
+	return _mm_movemask_epi8(_mm_or_si128(lo, hi)) != 0;
 }
 
 /*
- * CHECK NEW USER
- * Checks for the following errors related to the new user command:
- *     - user already exists.
- *     - too many users.
+ * FIND KEY (AVX2)
+ * Looks up a key in a table of keys, comparing each key at once.
  *
  * ARGS:
- *     - UserList *l: pointer to the Kanban's user list.
- *     - char user[]: user string to be checked.
+ *     - const char table[][KEY_SZ]: the table, aligned to KEY_SZ.
+ *     - int amount: amount of keys in the table.
+ *     - const char key[]: the key.
  * RETURN (int):
- *     - returns 1 if there are no errors, 0 otherwise.
+ *     - index of the key in the table, NO_KEY if it's not there.
  */
-int is_new_user_valid(UserList *l, char user[])
+KEY_TARGET("avx2")
+int find_key_avx2(const char table[][KEY_SZ], int amount, const char key[])
 {
-	if (is_existing_user(l, user))
-		printf(STR_FAIL_NEW_USER_USER_ALREADY_EXISTS);
-	else if (l->amount >= AMT_USERS)
-		printf(STR_FAIL_NEW_USER_TOO_MANY_USERS);
-	else
-		return 1;
+	int i;
+	__m256i k = _mm256_loadu_si256((const __m256i *) key);
 
-	return 0;
+	for (i = 0; i < amount; i++) {
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(k, _mm256_load_si256(
+				(const __m256i *) table[i]))) == -1)
+			return i;
+	}
+
+	return NO_KEY;
 }
 
 /*
- * CHECK MOVE
- * Checks for the following errors related to the move task command:
- *     - no such task.
- *     - same activity (doesn't print a message).
- *     - task already started.
- *     - no such user.
- *     - no such activity.
+ * HAS LOWERCASE (AVX2)
+ * Check if a key contains lowercase characters, all 32 bytes at once.
  *
  * ARGS:
- *     - Kanban *k: pointer to Kanban.
- *     - int id: id of task that will be moved.
- *     - char user[]: user string to be checked.
- *     - char activity[]: activity string to be checked.
+ *     - const char key[]: the key.
  * RETURN (int):
- *     - returns 1 if there are no errors, 0 otherwise.
+ *     - returns 1 if the key has any lowercase, 0 otherwise.
  */
-int is_move_valid(Kanban *k, int id, char user[], char activity[])
+KEY_TARGET("avx2")
+int has_lowercase_avx2(const char key[])
 {
-	if (id < 1 || id > k->tasks.amount)
-		printf(STR_FAIL_MOVE_TASK_NO_SUCH_TASK);
-	else if (strcmp(k->tasks.task[id - 1].activity, activity) == EQUAL)
-		return 0;
-	else if (strcmp(activity, STR_TO_DO) == EQUAL)
-		printf(STR_FAIL_MOVE_TASK_TASK_ALREADY_STARTED);
-	else if (!is_existing_user(&k->users, user))
-		printf(STR_FAIL_MOVE_TASK_NO_SUCH_USER);
-	else if (!is_existing_activity(&k->activities, activity))
-		printf(STR_FAIL_MOVE_TASK_NO_SUCH_ACTIVITY);
-	else
-		return 1;
+	__m256i k = _mm256_loadu_si256((const __m256i *) key);
 
-	return 0;
+	k = _mm256_and_si256(_mm256_cmpgt_epi8(k, _mm256_set1_epi8('a' - 1)),
+						 _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), k));
+
+	return _mm256_movemask_epi8(k) != 0;
 }
+#endif
 
+#ifdef BENCH
 /*
- * CHECK ACTIVITY
- * Checks for the following errors related to the display activity command:
- *     - no such activity.
+ * BENCHMARK KEYS HANDLING
+ * Related command: K <table size> <lookups>
+ * Times every key kernel the CPU supports on a table of <table size> keys:
+ * <lookups> lookups of keys spread over the table and of a missing key, and
+ * <lookups> lowercase checks. Then times the same lookups in a user list of
+ * <table size> users. Only compiled in when building with -DBENCH.
  *
  * ARGS:
- *     - ActivityList *l: pointer to the Kanban's activity list.
- *     - char activity[]: activity string to be checked.
+ *     - Stream *s: pointer to the stream the command is read from.
  * RETURN (int):
- *     - returns 1 if there are no errors, 0 otherwise.
+ *     - continues the infinite loop if KEEP_GOING.
  */
-int is_activity_valid(ActivityList *l, char activity[])
+int bench_keys(Stream *s)
 {
-	if (!is_existing_activity(l, activity))
-		printf(STR_FAIL_DISPLAY_ACTIVITY_NO_SUCH_ACTIVITY);
-	else
-		return 1;
+	int i, j, table_sz, lookups, amount_kernels = 1;
+	volatile int found = 0;
+	char (*table)[KEY_SZ];
+	char missing[KEY_SZ];
+	void *memory;
+	UserList users;
+	struct timespec start, end;
+	const char *name[BENCH_KERNELS] = {BENCH_SCALAR};
+	int (*find[BENCH_KERNELS])(const char [][KEY_SZ], int, const char []);
+	int (*lowercase[BENCH_KERNELS])(const char []);
 
-	return 0;
+	if (s->binary) {
+		decode_int(s, &table_sz);
+		decode_int(s, &lookups);
+	} else
+		fscanf(s->in, STR_MATCH_BENCH, &table_sz, &lookups);
+
+	if (table_sz < 1 || lookups < 1 ||
+		posix_memalign(&memory, KEY_SZ, (size_t) KEY_SZ * table_sz) != 0) {
+		reply(s, STATUS_INVALID_BENCH, STR_FAIL_BENCH);
+		return KEEP_GOING;
+	}
+
+	find[0] = find_key_scalar;
+	lowercase[0] = has_lowercase_scalar;
+#ifdef KEY_KERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2")) {
+		name[amount_kernels] = BENCH_SSE2;
+		find[amount_kernels] = find_key_sse2;
+		lowercase[amount_kernels++] = has_lowercase_sse2;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		name[amount_kernels] = BENCH_AVX2;
+		find[amount_kernels] = find_key_avx2;
+		lowercase[amount_kernels++] = has_lowercase_avx2;
+	}
+#endif
+
+	table = memory;
+	for (i = 0; i < table_sz; i++) {
+		memset(table[i], 0, KEY_SZ);
+		sprintf(table[i], STR_BENCH_KEY, i);
+	}
+	memset(missing, 0, KEY_SZ);
+	sprintf(missing, STR_BENCH_KEY, -1);
+
+	for (j = 0; j < amount_kernels; j++) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < lookups; i++)
+			found += find[j]((const char (*)[KEY_SZ]) table, table_sz,
+							 i % 2 ? table[(i / 2) % table_sz] : missing);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		reply(s, STATUS_OK, STR_SUCCESS_BENCH, BENCH_FIND_KEY, name[j],
+			  table_sz, bench_ns(&start, &end, lookups));
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < lookups; i++)
+			found += lowercase[j](table[i % table_sz]);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		reply(s, STATUS_OK, STR_SUCCESS_BENCH, BENCH_HAS_LOWERCASE, name[j],
+			  table_sz, bench_ns(&start, &end, lookups));
+	}
+
+	setup_users(&users);
+	for (i = 0; i < table_sz && append_user(&users, table[i]); i++)
+		;
+
+	if (i == table_sz) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < lookups; i++)
+			found += find_user(&users, i % 2 ? table[(i / 2) % table_sz]
+											 : missing);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		reply(s, STATUS_OK, STR_SUCCESS_BENCH, BENCH_FIND_USER, BENCH_HASH,
+			  table_sz, bench_ns(&start, &end, lookups));
+	} else
+		reply(s, STATUS_INVALID_BENCH, STR_FAIL_BENCH);
+
+	free_users(&users);
+	free(memory);
+
+	return KEEP_GOING;
 }
 
 /*
- * CHECK NEW ACTIVITY
- * Checks for the following errors related to the new activity command:
- *     - duplicate activity.
- *     - invalid description.
- *     - too many activities.
+ * BENCHMARK NANOSECONDS
+ * Average time of a call in a benchmark.
  *
  * ARGS:
- *     - ActivityList *l: pointer to the Kanban's activity list.
- *     - char activity[]: activity string to be checked.
- * RETURN (int):
- *     - returns 1 if there are no errors, 0 otherwise.
+ *     - struct timespec *start, *end: moments the calls started and ended.
+ *     - int calls: amount of calls.
+ * RETURN (unsigned int):
+ *     - average time of a call, in nanoseconds.
  */
-int is_new_activity_valid(ActivityList *l, char activity[])
+unsigned int bench_ns(struct timespec *start, struct timespec *end, int calls)
 {
-	if (is_existing_activity(l, activity))
-		printf(STR_FAIL_NEW_ACTIVITY_DUPLICATE_ACTIVITY);
-	else if (str_has_lowercase(activity))
-		printf(STR_FAIL_NEW_ACTIVITY_INVALID_DESCRIPTION);
-	else if (l->amount >= AMT_ACTIVITIES)
-		printf(STR_FAIL_NEW_ACTIVITY_TOO_MANY_ACTIVITIES);
-	else
-		return 1;
-
-	return 0;
+	return ((end->tv_sec - start->tv_sec) * 1000000000.0 +
+			(end->tv_nsec - start->tv_nsec)) / calls;
 }
+#endif
 
 
 /******************************************************************************
- * AUXILIARY ERROR CHECKING FUNCTIONS                                         *
+ * STREAM FUNCTIONS                                                           *
  ******************************************************************************/
 
 /*
- * CHECK FOR TASK DESCRIPTION DUPLICATES
- * Checks if there's another task with the same description in the kanban.
+ * OPEN STREAM
+ * Opens the stream commands will be read from. A binary command file is
+ * memory-mapped so its frames don't have to be copied, a text one is read
+ * through stdio like stdin.
  *
  * ARGS:
- *     - TaskList *l: pointer to the Kanban's taks list.
- *     - Task *t: pointer to the task whose description will be checked.
+ *     - Stream *s: pointer to the stream that will be opened.
+ *     - char path[]: path of the command file, NULL to read from stdin.
+ *     - int binary: true if the stream uses the binary protocol.
  * RETURN (int):
- *     - returns 1 if task descripion is duplicate, 0 otherwise.
+ *     - returns 1 if the stream was opened, 0 otherwise.
  */
-int is_task_description_duplicate(TaskList *l, Task *t)
+int open_stream(Stream *s, char path[], int binary)
 {
-	int i;
+	int fd;
+	struct stat st;
+	void *map;
 
-	for (i = 0; i < l->amount; i++) {
-		if(strcmp(t->description, l->task[i].description) == EQUAL)
-			return 1;
+	s->in = stdin;
+	s->out = stdout;
+	s->map = NULL;
+	s->map_sz = 0;
+	s->released = 0;
+	s->binary = binary;
+	s->pos = 0;
+	s->frame = NULL;
+	s->frame_sz = 0;
+	s->frame_pos = 0;
+
+	if (path == NULL)
+		return 1;
+
+	if (!binary)
+		return (s->in = fopen(path, "r")) != NULL;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return 0;
+
+	if (fstat(fd, &st) < 0 || st.st_size == 0) {
+		close(fd);
+		return (s->in = fopen(path, "rb")) != NULL;
 	}
 
-	return 0;
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return 0;
+
+	posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+	s->map = map;
+	s->map_sz = st.st_size;
+	s->in = NULL;
+
+	return 1;
 }
 
 /*
- * CHECK IF USER EXISTS
- * Check if user is already in the kanban.
+ * CLOSE STREAM
+ * Closes the stream and releases the memory-mapped command file, if any.
  *
  * ARGS:
- *     - UserList *l: pointer to the Kanban's user list.
- *     - char user[]: user string to be checked.
- * RETURN (int):
- *     - returns 1 if user is already in the list, 0 otherwise.
+ *     - Stream *s: pointer to the stream that will be closed.
+ * RETURN (void).
  */
-int is_existing_user(UserList *l, char user[])
+void close_stream(Stream *s)
 {
-	int i;
-
-	for (i = 0; i < l->amount; i++) {
-		if (strcmp(user, l->user[i]) == EQUAL)
-			return 1;
-	}
+	if (s->in != NULL && s->in != stdin)
+		fclose(s->in);
 
-	return 0;
+	if (s->map != NULL && s->released < s->map_sz)
+		munmap((void *) (s->map + s->released), s->map_sz - s->released);
 }
 
 /*
- * CHECK IF ACTIVITY EXISTS
- * Check if activity is already in the kanban.
+ * READ COMMAND
+ * Reads the next command from the stream. In text mode a command is a line
+ * and blank lines are skipped, in binary mode it is a frame whose first byte
+ * is the command character.
  *
  * ARGS:
- *     - ActivityList *l: pointer to the Kanban's activity list.
- *     - char activity[]: activity string to be checked.
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - int *cmd_code: where the command character is stored.
+ *     - int *has_args: where it is stored if the command has further arguments.
  * RETURN (int):
- *     - returns 1 if activity is already in the list, 0 otherwise.
+ *     - returns 1 if a command was read, 0 if the commands ran out.
  */
-int is_existing_activity(ActivityList *l, char activity[])
+int read_command(Stream *s, int *cmd_code, int *has_args)
 {
-	int i;
+	if (s->binary) {
+		if (!read_frame(s))
+			return 0;
 
-	for (i = 0; i < l->amount; i++) {
-		if (strcmp(activity, l->activity[i]) == EQUAL)
-			return 1;
+		*cmd_code = s->frame_sz > 0 ? s->frame[s->frame_pos++] : '\0';
+		*has_args = s->frame_sz > 1;
+		return 1;
 	}
 
-	return 0;
+	do {
+		*cmd_code = fgetc(s->in);
+	} while ('\n' == *cmd_code);
+
+	if (EOF == *cmd_code)
+		return 0;
+
+	*has_args = ('\n' != fgetc(s->in));
+	return 1;
 }
 
 /*
- * CHECK LOWERCASE
- * Check if string contains lowercase characters.
+ * READ FRAME
+ * Reads the next binary frame: a 4 byte big-endian payload size followed by
+ * the payload. Memory-mapped frames are used in place, and the contents
+ * before them are unmapped every MAP_RELEASE_SZ bytes, as the previous frame
+ * is no longer used.
  *
  * ARGS:
- *     - char s[]: string to be checked.
+ *     - Stream *s: pointer to the stream the frame is read from.
  * RETURN (int):
- *     - returns 1 if string has any lowercase, 0 otherwise.
+ *     - returns 1 if a whole frame was read, 0 otherwise.
  */
-int str_has_lowercase(char s[])
+int read_frame(Stream *s)
 {
-	int i, sz;
+	unsigned char header[FRAME_HEADER_SZ];
 
-	sz = strlen(s);
-	for (i = 0; i < sz; i++) {
-		if (islower(s[i]))
-			return 1;
+	s->frame_pos = 0;
+
+	if (s->map != NULL) {
+		if (s->pos - s->released >= MAP_RELEASE_SZ) {
+			munmap((void *) (s->map + s->released), MAP_RELEASE_SZ);
+			s->released += MAP_RELEASE_SZ;
+		}
+
+		if (s->map_sz - s->pos < FRAME_HEADER_SZ)
+			return 0;
+
+		s->frame_sz = get_u32((const unsigned char *) s->map + s->pos);
+		s->pos += FRAME_HEADER_SZ;
+		if (s->frame_sz > s->map_sz - s->pos)
+			return 0;
+
+		s->frame = (const unsigned char *) s->map + s->pos;
+		s->pos += s->frame_sz;
+		return 1;
 	}
 
-	return 0;
-}
+	if (fread(header, 1, FRAME_HEADER_SZ, s->in) != FRAME_HEADER_SZ)
+		return 0;
 
+	s->frame_sz = get_u32(header);
+	if (s->frame_sz > FRAME_SZ)
+		return 0;
 
-/******************************************************************************
- * PRINTING FUNCTIONS                                                         *
- ******************************************************************************/
+	s->frame = s->buffer;
+	return fread(s->buffer, 1, s->frame_sz, s->in) == s->frame_sz;
+}
 
 /*
- * PRINT TASK
- * Print the task with the given id.
+ * READ DESCRIPTION
+ * Reads the duration and description of a new task. Descriptions are cut to
+ * TASK_DESCRIPTION_SZ - 1 characters.
  *
  * ARGS:
- *     - TaskList *l: pointer to the Kanban's task list.
- *     - int id: id of the task to be printed.
+ *     - Stream *s: pointer to the stream the description is read from.
+ *     - Task *t: pointer to the task where they are stored.
  * RETURN (void).
  */
-void print_task(TaskList *l, int id)
+void read_description(Stream *s, Task *t)
 {
-	printf(STR_SUCCESS_LIST_TASKS, id,
-		   l->task[id - 1].activity,
-		   l->task[id - 1].duration,
-		   l->task[id - 1].description);
+	if (s->binary) {
+		decode_int(s, &t->duration);
+		decode_word(s, t->description, TASK_DESCRIPTION_SZ);
+	} else {
+		t->description[0] = '\0';
+		fscanf(s->in, STR_MATCH_NEW_TASK, &t->duration, t->description);
+	}
 }
 
 /*
- * PRINT ACTIVITY
- * Print all tasks in an activity.
+ * DECODE INTEGER
+ * Decodes a 4 byte big-endian integer field from the current frame.
  *
  * ARGS:
- *     - Kanban *k: pointer to Kanban.
- *     - char activity[]: string of the activity to be printed.
- *     - int order[]: order in wich the tasks in the activity will be printed.
- *     - int sz: size of order vector.
- * RETURN (void).
+ *     - Stream *s: pointer to the stream whose frame is decoded.
+ *     - int *x: where the integer is stored, 0 if the frame ran out.
+ * RETURN (int):
+ *     - returns 1 if the field was decoded, 0 if the frame ran out.
  */
-void print_activity(Kanban *k, char activity[], int order[], int sz)
+int decode_int(Stream *s, int *x)
 {
-	int i;
-	Task t;
+	*x = 0;
 
-	for (i = 0; i < sz; i++) {
-		t = k->tasks.task[order[i]];
+	if (s->frame_sz - s->frame_pos < INT_FIELD_SZ)
+		return 0;
 
-		if (strcmp(t.activity, activity) == EQUAL)
-			printf(STR_SUCCESS_DISPLAY_ACTIVITY,
-				   order[i] + 1, t.start, t.description);
-	}
+	*x = (int) get_u32(s->frame + s->frame_pos);
+	s->frame_pos += INT_FIELD_SZ;
+	return 1;
 }
 
-
-/******************************************************************************
- * VECTOR MANIPULATION FUNCTIONS                                              *
- ******************************************************************************/
-
 /*
- * TASK ORDER INSERTION
+ * DECODE STRING
+ * Decodes a string field from the current frame: a 1 byte size followed by
+ * the characters. The string is referenced in place.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream whose frame is decoded.
+ *     - const char **str: where the pointer to the characters is stored.
+ *     - int *sz: where the size is stored, 0 if the frame ran out.
+ * RETURN (int):
+ *     - returns 1 if the field was decoded, 0 if the frame ran out.
+ */
+int decode_str(Stream *s, const char **str, int *sz)
+{
+	*str = (const char *) s->frame + s->frame_pos;
+	*sz = 0;
+
+	if (s->frame_pos >= s->frame_sz ||
+		s->frame[s->frame_pos] > s->frame_sz - s->frame_pos - 1)
+		return 0;
+
+	*sz = s->frame[s->frame_pos++];
+	*str = (const char *) s->frame + s->frame_pos;
+	s->frame_pos += *sz;
+	return 1;
+}
+
+/*
+ * DECODE WORD
+ * Decodes a string field from the current frame into a null terminated
+ * string, truncating it if it doesn't fit.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream whose frame is decoded.
+ *     - char word[]: where the string is stored.
+ *     - int word_sz: size of the word vector.
+ * RETURN (int):
+ *     - returns 1 if the field was decoded, 0 if the frame ran out.
+ */
+int decode_word(Stream *s, char word[], int word_sz)
+{
+	const char *str;
+	int sz, ok;
+
+	ok = decode_str(s, &str, &sz);
+	if (sz >= word_sz)
+		sz = word_sz - 1;
+
+	memcpy(word, str, sz);
+	word[sz] = '\0';
+	return ok;
+}
+
+/*
+ * REPLY
+ * Writes a reply to the stream. In text mode the format is printed as is, in
+ * binary mode the reply is a frame with the status code followed by each
+ * argument of the format as a field.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the reply is written to.
+ *     - int status: status code of the reply.
+ *     - const char *fmt: text format of the reply.
+ *     - ...: arguments of the format.
+ * RETURN (void).
+ */
+void reply(Stream *s, int status, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	if (s->binary)
+		encode_reply(s, status, fmt, ap);
+	else
+		vfprintf(s->out, fmt, ap);
+	va_end(ap);
+}
+
+/*
+ * ENCODE REPLY
+ * Writes a binary reply frame. Integer conversions (%d, %u) become 4 byte
+ * big-endian fields and string conversions (%s) become string fields.
+ * If a field doesn't fit in the frame, a STATUS_REPLY_TOO_LONG frame with no
+ * fields is written instead, so a reply is never cut short.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the reply is written to.
+ *     - int status: status code of the reply.
+ *     - const char *fmt: text format of the reply.
+ *     - va_list ap: arguments of the format.
+ * RETURN (void).
+ */
+void encode_reply(Stream *s, int status, const char *fmt, va_list ap)
+{
+	unsigned char frame[REPLY_FRAME_SZ];
+	unsigned long sz = FRAME_HEADER_SZ;
+	const char *str;
+	int str_sz;
+
+	frame[sz++] = status;
+
+	for (; *fmt != '\0'; fmt++) {
+		if (*fmt != '%')
+			continue;
+
+		if (*++fmt == 's') {
+			str = va_arg(ap, const char *);
+			str_sz = strlen(str);
+		} else {
+			if (sz + INT_FIELD_SZ > REPLY_FRAME_SZ)
+				break;
+			put_u32(&frame[sz], *fmt == 'u' ? va_arg(ap, unsigned int)
+											: (unsigned long) va_arg(ap, int));
+			sz += INT_FIELD_SZ;
+			continue;
+		}
+
+		if (str_sz > STR_FIELD_SZ || sz + 1 + str_sz > REPLY_FRAME_SZ)
+			break;
+		frame[sz++] = str_sz;
+		memcpy(&frame[sz], str, str_sz);
+		sz += str_sz;
+	}
+
+	if (*fmt != '\0') {
+		sz = FRAME_HEADER_SZ;
+		frame[sz++] = STATUS_REPLY_TOO_LONG;
+	}
+
+	put_u32(frame, sz - FRAME_HEADER_SZ);
+	fwrite(frame, 1, sz, s->out);
+}
+
+/*
+ * END REPLY
+ * Marks the end of the reply to a command. Only binary mode needs it, since a
+ * command can have any amount of reply frames.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the reply is written to.
+ * RETURN (void).
+ */
+void end_reply(Stream *s)
+{
+	if (s->binary)
+		reply(s, STATUS_END, "");
+}
+
+/*
+ * REPLAY CACHE
+ * Writes a cached reply if it was formatted from the current version.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the reply is written to.
+ *     - ResultCache *c: pointer to the cache.
+ *     - unsigned long version: current version of the listed data.
+ * RETURN (int):
+ *     - returns 1 if the cached reply was written, 0 if it's stale.
+ */
+int replay_cache(Stream *s, ResultCache *c, unsigned long version)
+{
+	if (c->bytes == NULL || c->version != version)
+		return 0;
+
+	fwrite(c->bytes, 1, c->sz, s->out);
+	return 1;
+}
+
+/*
+ * BEGIN CACHE
+ * Drops a stale cached reply and redirects the replies that follow into the
+ * cache, until end_cache().
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the reply is written to.
+ *     - ResultCache *c: pointer to the cache.
+ * RETURN (FILE *):
+ *     - stream the reply has to be written to in the end, NULL if replies
+ *       could not be redirected and are written directly.
+ */
+FILE *begin_cache(Stream *s, ResultCache *c)
+{
+	FILE *out = s->out;
+
+	free(c->bytes);
+	c->bytes = NULL;
+
+	if ((s->out = open_memstream(&c->bytes, &c->sz)) == NULL) {
+		s->out = out;
+		return NULL;
+	}
+
+	return out;
+}
+
+/*
+ * END CACHE
+ * Stops redirecting replies into the cache, stores the version they were
+ * formatted from and writes them to the stream.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the reply is written to.
+ *     - ResultCache *c: pointer to the cache.
+ *     - FILE *out: stream returned by begin_cache().
+ *     - unsigned long version: version of the listed data.
+ * RETURN (void).
+ */
+void end_cache(Stream *s, ResultCache *c, FILE *out, unsigned long version)
+{
+	if (out == NULL)
+		return;
+
+	fclose(s->out);
+	s->out = out;
+	c->version = version;
+
+	if (c->bytes != NULL)
+		fwrite(c->bytes, 1, c->sz, s->out);
+}
+
+/*
+ * GET 32 BIT INTEGER
+ * Reads a 4 byte big-endian unsigned integer.
+ *
+ * ARGS:
+ *     - const unsigned char bytes[]: bytes of the integer.
+ * RETURN (unsigned long):
+ *     - the integer.
+ */
+unsigned long get_u32(const unsigned char bytes[])
+{
+	return ((unsigned long) bytes[0] << 24) | ((unsigned long) bytes[1] << 16) |
+		   ((unsigned long) bytes[2] << 8) | (unsigned long) bytes[3];
+}
+
+/*
+ * PUT 32 BIT INTEGER
+ * Writes a 4 byte big-endian unsigned integer.
+ *
+ * ARGS:
+ *     - unsigned char bytes[]: where the bytes of the integer are written.
+ *     - unsigned long x: the integer.
+ * RETURN (void).
+ */
+void put_u32(unsigned char bytes[], unsigned long x)
+{
+	bytes[0] = (x >> 24) & 0xff;
+	bytes[1] = (x >> 16) & 0xff;
+	bytes[2] = (x >> 8) & 0xff;
+	bytes[3] = x & 0xff;
+}
+
+
+/******************************************************************************
+ * BOARD MANAGEMENT FUNCTIONS                                                 *
+ ******************************************************************************/
+
+/*
+ * SETUP BOARDS
+ * Setups the board manager with a single board, BOARD_DEFAULT, and starts
+ * the eviction and reporter threads.
+ *
+ * ARGS:
+ *     - BoardManager *m: pointer to the board manager.
+ *     - int user_limit: maximum amount of users in each board, NO_LIMIT if
+ *       there's none.
+ * RETURN (int):
+ *     - returns 1 on success, 0 otherwise.
+ */
+int setup_boards(BoardManager *m, int user_limit)
+{
+	int i;
+
+	m->board = NULL;
+	m->amount = 0;
+	m->capacity = 0;
+	m->amount_slots = BOARD_INITIAL_SLOTS;
+	m->newest = NO_BOARD;
+	m->oldest = NO_BOARD;
+	m->resident_bytes = 0;
+	m->evicting = NO_BOARD;
+	m->clock = 0;
+	m->stopping = 0;
+	m->amount_reporters = 0;
+	m->report_ids = 0;
+	m->report_round = 0;
+	m->user_limit = user_limit;
+
+	pthread_mutex_init(&m->lock, NULL);
+	pthread_cond_init(&m->work, NULL);
+	pthread_cond_init(&m->done, NULL);
+	pthread_cond_init(&m->report_work, NULL);
+	pthread_cond_init(&m->report_done, NULL);
+
+	if ((m->slot = malloc(sizeof(int) * m->amount_slots)) == NULL)
+		return 0;
+	for (i = 0; i < m->amount_slots; i++)
+		m->slot[i] = NO_BOARD;
+
+	strcpy(m->dir, BOARD_DIR_TEMPLATE);
+	if (mkdtemp(m->dir) == NULL ||
+		(m->current = add_board(m, BOARD_DEFAULT)) == NO_BOARD)
+		return 0;
+
+	for (i = 0; i < REPORT_THREADS; i++) {
+		if (pthread_create(&m->reporter[i], NULL, scan_boards, m) != 0)
+			return 0;
+		m->amount_reporters++;
+	}
+
+	return pthread_create(&m->evictor, NULL, evict_boards, m) == 0;
+}
+
+/*
+ * CLOSE BOARDS
+ * Stops the eviction and reporter threads and releases every board, removing
+ * the images of the hibernated ones.
+ *
+ * ARGS:
+ *     - BoardManager *m: pointer to the board manager.
+ * RETURN (void).
+ */
+void close_boards(BoardManager *m)
+{
+	int i;
+	char path[BOARD_PATH_SZ];
+
+	pthread_mutex_lock(&m->lock);
+	m->stopping = 1;
+	pthread_cond_signal(&m->work);
+	pthread_cond_broadcast(&m->report_work);
+	pthread_mutex_unlock(&m->lock);
+	pthread_join(m->evictor, NULL);
+	for (i = 0; i < m->amount_reporters; i++)
+		pthread_join(m->reporter[i], NULL);
+
+	for (i = 0; i < m->amount; i++) {
+		if (m->board[i].state == BOARD_HIBERNATED) {
+			board_path(m, i, path);
+			remove(path);
+		} else {
+			free_caches(m->board[i].k);
+			free_history(&m->board[i].k->tasks);
+			free_users(&m->board[i].k->users);
+			free(m->board[i].k);
+		}
+		free_subscribers(m->board[i].subscribers);
+	}
+
+	rmdir(m->dir);
+	free(m->board);
+	free(m->slot);
+	pthread_mutex_destroy(&m->lock);
+	pthread_cond_destroy(&m->work);
+	pthread_cond_destroy(&m->done);
+	pthread_cond_destroy(&m->report_work);
+	pthread_cond_destroy(&m->report_done);
+}
+
+/*
+ * SWITCH BOARD HANDLING
+ * Related command: b [<board>]
+ * Makes the board with the given name current, creating it if it's new. With
+ * no name, lists the boards instead.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - BoardManager *m: pointer to the board manager.
+ *     - char has_args: true if the user input has further arguments.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int switch_board(Stream *s, BoardManager *m, int has_args)
+{
+	int i, has_name = 0;
+	char name[BOARD_NAME_SZ];
+
+	if (has_args && s->binary)
+		has_name = decode_word(s, name, BOARD_NAME_SZ) && name[0] != '\0';
+	else if (has_args)
+		has_name = fscanf(s->in, STR_MATCH_BOARD, name) == 1;
+
+	if (!has_name)
+		return list_boards(s, m);
+
+	if ((i = find_board(m, name)) == NO_BOARD &&
+		(i = add_board(m, name)) == NO_BOARD) {
+		reply(s, STATUS_CANNOT_ADD_BOARD, STR_FAIL_ADD_BOARD, name);
+		return KEEP_GOING;
+	}
+
+	m->current = i;
+
+	return KEEP_GOING;
+}
+
+/*
+ * LIST BOARDS HANDLING
+ * Related command: b
+ * Lists the boards, in creation order.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the reply is written to.
+ *     - BoardManager *m: pointer to the board manager.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int list_boards(Stream *s, BoardManager *m)
+{
+	int i;
+
+	for (i = 0; i < m->amount; i++)
+		reply(s, STATUS_OK, STR_SUCCESS_LIST_BOARDS, m->board[i].name);
+
+	return KEEP_GOING;
+}
+
+/*
+ * WAKE BOARD
+ * Makes sure the current board is in memory, loading its image if it was
+ * hibernated, and marks it as the most recently used.
+ *
+ * ARGS:
+ *     - BoardManager *m: pointer to the board manager.
+ * RETURN (Kanban *):
+ *     - pointer to the current board's Kanban, NULL if it couldn't be loaded.
+ */
+Kanban *wake_board(BoardManager *m)
+{
+	int i = m->current, state;
+	char path[BOARD_PATH_SZ];
+	Kanban *k = NULL;
+
+	pthread_mutex_lock(&m->lock);
+	while ((state = m->board[i].state) == BOARD_EVICTING)
+		pthread_cond_wait(&m->done, &m->lock);
+	pthread_mutex_unlock(&m->lock);
+
+	if (state == BOARD_HIBERNATED) {
+		TRACE_BEGIN("wake_board");
+		board_path(m, i, path);
+		if ((k = alloc_kanban()) == NULL || !load_board(k, path)) {
+			free(k);
+			TRACE_END("wake_board", i);
+			return NULL;
+		}
+		remove(path);
+		TRACE_END("wake_board", i);
+
+		k->subscribers = m->board[i].subscribers;
+		k->users.limit = m->user_limit;
+
+		pthread_mutex_lock(&m->lock);
+		m->board[i].k = k;
+		m->board[i].state = BOARD_RESIDENT;
+		pthread_mutex_unlock(&m->lock);
+		push_resident(m, i);
+	} else if (state == BOARD_STRANDED) {
+		m->board[i].state = BOARD_RESIDENT;
+		push_resident(m, i);
+	} else if (m->newest != i) {
+		unlink_resident(m, i);
+		push_resident(m, i);
+	}
+
+	m->board[i].last_used = m->clock;
+
+	return m->board[i].k;
+}
+
+/*
+ * HIBERNATE IDLE BOARDS
+ * Hands the least recently used boards to the eviction thread, while they
+ * have been idle for more than BOARD_IDLE_COMMANDS commands or there are
+ * more resident boards than fit in the memory budget.
+ *
+ * ARGS:
+ *     - BoardManager *m: pointer to the board manager.
+ * RETURN (void).
+ */
+void hibernate_idle_boards(BoardManager *m)
+{
+	int i;
+
+	pthread_mutex_lock(&m->lock);
+
+	while ((i = m->oldest) != NO_BOARD && i != m->current &&
+		   (m->resident_bytes > BOARD_MEMORY_BUDGET ||
+			m->clock - m->board[i].last_used > BOARD_IDLE_COMMANDS)) {
+		unlink_resident(m, i);
+		m->board[i].state = BOARD_EVICTING;
+		m->board[i].next_evicting = m->evicting;
+		m->evicting = i;
+		pthread_cond_signal(&m->work);
+	}
+
+	pthread_mutex_unlock(&m->lock);
+}
+
+/*
+ * EVICT BOARDS
+ * Body of the eviction thread: writes the image of each board waiting to be
+ * evicted and releases its memory, until the manager is closed.
+ *
+ * ARGS:
+ *     - void *arg: pointer to the board manager.
+ * RETURN (void *):
+ *     - NULL.
+ */
+void *evict_boards(void *arg)
+{
+	int i, saved;
+	char path[BOARD_PATH_SZ];
+	BoardManager *m = arg;
+	Kanban *k;
+
+	pthread_mutex_lock(&m->lock);
+
+	while (!m->stopping || m->evicting != NO_BOARD) {
+		if (m->evicting == NO_BOARD) {
+			pthread_cond_wait(&m->work, &m->lock);
+			continue;
+		}
+
+		i = m->evicting;
+		m->evicting = m->board[i].next_evicting;
+		k = m->board[i].k;
+		board_path(m, i, path);
+		pthread_mutex_unlock(&m->lock);
+
+		TRACE_BEGIN("hibernate_board");
+		if ((saved = save_board(k, path))) {
+			free_caches(k);
+			free_history(&k->tasks);
+			free_users(&k->users);
+			free(k);
+		}
+		TRACE_END("hibernate_board", i);
+
+		pthread_mutex_lock(&m->lock);
+		if (saved) {
+			m->board[i].k = NULL;
+			m->board[i].state = BOARD_HIBERNATED;
+		} else
+			m->board[i].state = BOARD_STRANDED;
+		pthread_cond_broadcast(&m->done);
+	}
+
+	pthread_mutex_unlock(&m->lock);
+
+	return NULL;
+}
+
+/*
+ * FIND BOARD
+ * Looks up a board by name.
+ *
+ * ARGS:
+ *     - BoardManager *m: pointer to the board manager.
+ *     - char name[]: name of the board.
+ * RETURN (int):
+ *     - index of the board, NO_BOARD if there's none with that name.
+ */
+int find_board(BoardManager *m, char name[])
+{
+	unsigned long h = hash_str(name);
+	int i;
+
+	while ((i = m->slot[h & (m->amount_slots - 1)]) != NO_BOARD) {
+		if (strcmp(m->board[i].name, name) == EQUAL)
+			return i;
+		h++;
+	}
+
+	return NO_BOARD;
+}
+
+/*
+ * ADD BOARD
+ * Creates a new, empty and resident board.
+ *
+ * ARGS:
+ *     - BoardManager *m: pointer to the board manager.
+ *     - char name[]: name of the board.
+ * RETURN (int):
+ *     - index of the new board, NO_BOARD if there was no memory for it.
+ */
+int add_board(BoardManager *m, char name[])
+{
+	int i, capacity = m->capacity > 0 ? m->capacity * 2 : BOARD_INITIAL_SLOTS;
+	int *slot;
+	Board *board;
+	Kanban *k;
+	SubscriberList *subscribers;
+
+	if ((k = alloc_kanban()) == NULL)
+		return NO_BOARD;
+	if ((subscribers = calloc(1, sizeof(SubscriberList))) == NULL) {
+		free(k);
+		return NO_BOARD;
+	}
+
+	if (m->amount == m->capacity) {
+		pthread_mutex_lock(&m->lock);
+		board = realloc(m->board, sizeof(Board) * capacity);
+		if (board != NULL) {
+			m->board = board;
+			m->capacity = capacity;
+		}
+		pthread_mutex_unlock(&m->lock);
+
+		if (board == NULL) {
+			free(subscribers);
+			free(k);
+			return NO_BOARD;
+		}
+	}
+
+	if (m->amount * 2 >= m->amount_slots) {
+		if ((slot = malloc(sizeof(int) * m->amount_slots * 2)) == NULL) {
+			free(subscribers);
+			free(k);
+			return NO_BOARD;
+		}
+		free(m->slot);
+		m->slot = slot;
+		m->amount_slots *= 2;
+		for (i = 0; i < m->amount_slots; i++)
+			m->slot[i] = NO_BOARD;
+		for (i = 0; i < m->amount; i++)
+			index_board(m, i);
+	}
+
+	setup(k);
+	k->subscribers = subscribers;
+	k->users.limit = m->user_limit;
+	i = m->amount++;
+	strcpy(m->board[i].name, name);
+	m->board[i].k = k;
+	m->board[i].subscribers = subscribers;
+	m->board[i].state = BOARD_RESIDENT;
+	m->board[i].last_used = m->clock;
+	index_board(m, i);
+	push_resident(m, i);
+
+	return i;
+}
+
+/*
+ * INDEX BOARD
+ * Adds a board to the hash table of board names.
+ *
+ * ARGS:
+ *     - BoardManager *m: pointer to the board manager.
+ *     - int i: index of the board.
+ * RETURN (void).
+ */
+void index_board(BoardManager *m, int i)
+{
+	unsigned long h = hash_str(m->board[i].name);
+
+	while (m->slot[h & (m->amount_slots - 1)] != NO_BOARD)
+		h++;
+
+	m->slot[h & (m->amount_slots - 1)] = i;
+}
+
+/*
+ * PUSH RESIDENT BOARD
+ * Adds a board to the list of resident boards as the most recently used.
+ *
+ * ARGS:
+ *     - BoardManager *m: pointer to the board manager.
+ *     - int i: index of the board.
+ * RETURN (void).
+ */
+void push_resident(BoardManager *m, int i)
+{
+	m->board[i].newer = NO_BOARD;
+	m->board[i].older = m->newest;
+
+	if (m->newest != NO_BOARD)
+		m->board[m->newest].newer = i;
+	else
+		m->oldest = i;
+
+	m->newest = i;
+	m->board[i].bytes = board_bytes(m->board[i].k);
+	m->resident_bytes += m->board[i].bytes;
+}
+
+/*
+ * UNLINK RESIDENT BOARD
+ * Removes a board from the list of resident boards.
+ *
+ * ARGS:
+ *     - BoardManager *m: pointer to the board manager.
+ *     - int i: index of the board.
+ * RETURN (void).
+ */
+void unlink_resident(BoardManager *m, int i)
+{
+	if (m->board[i].newer != NO_BOARD)
+		m->board[m->board[i].newer].older = m->board[i].older;
+	else
+		m->newest = m->board[i].older;
+
+	if (m->board[i].older != NO_BOARD)
+		m->board[m->board[i].older].newer = m->board[i].newer;
+	else
+		m->oldest = m->board[i].newer;
+
+	m->resident_bytes -= m->board[i].bytes;
+}
+
+/*
+ * ACCOUNT BOARD
+ * Updates the memory a resident board is accounted for, after it ran a
+ * command.
+ *
+ * ARGS:
+ *     - BoardManager *m: pointer to the board manager.
+ *     - int i: index of the board.
+ * RETURN (void).
+ */
+void account_board(BoardManager *m, int i)
+{
+	m->resident_bytes -= m->board[i].bytes;
+	m->board[i].bytes = board_bytes(m->board[i].k);
+	m->resident_bytes += m->board[i].bytes;
+}
+
+/*
+ * BOARD PATH
+ * Builds the path of a board's image.
+ *
+ * ARGS:
+ *     - BoardManager *m: pointer to the board manager.
+ *     - int i: index of the board.
+ *     - char path[]: where the path is stored, BOARD_PATH_SZ long.
+ * RETURN (void).
+ */
+void board_path(BoardManager *m, int i, char path[])
+{
+	snprintf(path, BOARD_PATH_SZ, STR_BOARD_PATH, m->dir, i);
+}
+
+/*
+ * SAVE BOARD
+ * Writes a compact image of a Kanban: only the users, activities and tasks
+ * in use, each task with its description and history inline. Listing caches
+ * and subscribers are left out.
+ *
+ * ARGS:
+ *     - Kanban *k: pointer to the Kanban.
+ *     - char path[]: path of the image.
+ * RETURN (int):
+ *     - returns 1 if the whole image was written, 0 otherwise.
+ */
+int save_board(Kanban *k, char path[])
+{
+	int i, ok;
+	Task *t;
+	FILE *f;
+
+	if ((f = fopen(path, "wb")) == NULL)
+		return 0;
+
+	fwrite(&k->now, sizeof(k->now), 1, f);
+	fwrite(&k->users.amount, sizeof(int), 1, f);
+	if (k->users.amount > 0)
+		fwrite(k->users.user, KEY_SZ, k->users.amount, f);
+	fwrite(&k->activities.amount, sizeof(int), 1, f);
+	fwrite(k->activities.activity, KEY_SZ, k->activities.amount, f);
+
+	fwrite(&k->tasks.amount, sizeof(int), 1, f);
+	fwrite(&k->tasks.amount_sorted, sizeof(int), 1, f);
+	fwrite(&k->tasks.amount_started, sizeof(int), 1, f);
+	fwrite(&k->tasks.first_at_current_time, sizeof(int), 1, f);
+	fwrite(&k->tasks.history_horizon, sizeof(unsigned int), 1, f);
+	fwrite(k->tasks.ordered_by_description, sizeof(int), k->tasks.amount, f);
+	fwrite(k->tasks.ordered_by_start, sizeof(int), k->tasks.amount_started, f);
+
+	for (i = 0; i < k->tasks.amount; i++) {
+		t = &k->tasks.task[i];
+		fwrite(&t->duration, sizeof(int), 1, f);
+		fwrite(&t->start, sizeof(unsigned int), 1, f);
+		fwrite(&t->finish, sizeof(unsigned int), 1, f);
+		fwrite(t->user, USER_SZ, 1, f);
+		fwrite(t->activity, ACTIVITY_SZ, 1, f);
+		fwrite(t->description, TASK_DESCRIPTION_SZ, 1, f);
+		fwrite(&t->history_sz, sizeof(int), 1, f);
+		if (t->history_sz > 0)
+			fwrite(t->history, sizeof(Transition), t->history_sz, f);
+	}
+
+	ok = !ferror(f);
+	return fclose(f) == 0 && ok;
+}
+
+/*
+ * LOAD BOARD
+ * Reads a Kanban from the image written by save_board().
+ *
+ * ARGS:
+ *     - Kanban *k: pointer to the Kanban where the image is loaded.
+ *     - char path[]: path of the image.
+ * RETURN (int):
+ *     - returns 1 if a whole valid image was read, 0 otherwise.
+ */
+int load_board(Kanban *k, char path[])
+{
+	int i, ok, amount_users, amount_read, owner;
+	char user[KEY_SZ];
+	Task *t;
+	TaskList *l = &k->tasks;
+	FILE *f;
+
+	setup_caches(k);
+	setup_users(&k->users);
+	l->heap_sz = 0;
+	k->subscribers = NULL;
+
+	if ((f = fopen(path, "rb")) == NULL)
+		return 0;
+
+	ok = fread(&k->now, sizeof(k->now), 1, f) == 1 &&
+		 fread(&amount_users, sizeof(int), 1, f) == 1 && amount_users >= 0;
+
+	for (i = 0; ok && i < amount_users; i++)
+		ok = fread(user, KEY_SZ, 1, f) == 1 && append_user(&k->users, user);
+
+	ok = ok &&
+		 fread(&k->activities.amount, sizeof(int), 1, f) == 1 &&
+		 k->activities.amount >= 0 && k->activities.amount <= AMT_ACTIVITIES &&
+		 fread(k->activities.activity, KEY_SZ, k->activities.amount, f) ==
+			(size_t) k->activities.amount &&
+		 fread(&l->amount, sizeof(int), 1, f) == 1 &&
+		 fread(&l->amount_sorted, sizeof(int), 1, f) == 1 &&
+		 fread(&l->amount_started, sizeof(int), 1, f) == 1 &&
+		 fread(&l->first_at_current_time, sizeof(int), 1, f) == 1 &&
+		 fread(&l->history_horizon, sizeof(unsigned int), 1, f) == 1 &&
+		 l->amount >= 0 && l->amount <= AMT_TASKS &&
+		 l->amount_sorted >= 0 && l->amount_sorted <= l->amount &&
+		 l->amount_started >= 0 && l->amount_started <= l->amount &&
+		 fread(l->ordered_by_description, sizeof(int), l->amount, f) ==
+			(size_t) l->amount &&
+		 fread(l->ordered_by_start, sizeof(int), l->amount_started, f) ==
+			(size_t) l->amount_started;
+
+	for (i = 0; ok && i < l->amount; i++) {
+		t = &l->task[i];
+		t->history = NULL;
+		ok = fread(&t->duration, sizeof(int), 1, f) == 1 &&
+			 fread(&t->start, sizeof(unsigned int), 1, f) == 1 &&
+			 fread(&t->finish, sizeof(unsigned int), 1, f) == 1 &&
+			 fread(t->user, USER_SZ, 1, f) == 1 &&
+			 fread(t->activity, ACTIVITY_SZ, 1, f) == 1 &&
+			 fread(t->description, TASK_DESCRIPTION_SZ, 1, f) == 1 &&
+			 memchr(t->description, '\0', TASK_DESCRIPTION_SZ) != NULL &&
+			 fread(&t->history_sz, sizeof(int), 1, f) == 1 &&
+			 t->history_sz >= 0 && t->history_sz <= HISTORY_RETENTION &&
+			 (t->history_sz == 0 ||
+			  ((t->history = malloc(sizeof(Transition) * t->history_sz))
+				!= NULL &&
+			   fread(t->history, sizeof(Transition), t->history_sz, f) ==
+				(size_t) t->history_sz));
+		l->heap_sz += sizeof(Transition) * t->history_sz;
+	}
+	amount_read = i;
+
+	for (i = 0; ok && i < l->amount; i++) {
+		t = &l->task[i];
+		if (strcmp(t->activity, STR_TO_DO) != EQUAL &&
+			(owner = find_user(&k->users, t->user)) != NO_USER)
+			assign_task(&k->users, l, owner, i + 1);
+	}
+
+	if (!ok) {
+		l->amount = amount_read;
+		free_history(l);
+		free_users(&k->users);
+	}
+
+	fclose(f);
+	return ok;
+}
+
+/*
+ * HASH STRING
+ * Hashes a string (djb2).
+ *
+ * ARGS:
+ *     - const char s[]: string to hash.
+ * RETURN (unsigned long):
+ *     - the hash.
+ */
+unsigned long hash_str(const char s[])
+{
+	unsigned long h = 5381;
+
+	while (*s != '\0')
+		h = h * 33 + (unsigned char) *s++;
+
+	return h;
+}
+
+
+/******************************************************************************
+ * CHANGE DATA CAPTURE FUNCTIONS                                              *
+ ******************************************************************************/
+
+/*
+ * PUBLISH CHANGE
+ * Numbers a change and puts it in the ring of every subscriber, overwriting
+ * the oldest change if the ring is full.
+ *
+ * ARGS:
+ *     - Kanban *k: pointer to Kanban.
+ *     - Change *c: pointer to the change, its sequence number is set.
+ * RETURN (void).
+ */
+void publish(Kanban *k, Change *c)
+{
+	int i;
+	Subscriber *sub;
+	SubscriberList *l = k->subscribers;
+
+	if (l == NULL)
+		return;
+
+	c->seq = ++l->seq;
+
+	for (i = 0; i < l->amount; i++) {
+		sub = &l->subscriber[i];
+		if (sub->change != NULL)
+			sub->change[c->seq % sub->ring_sz] = *c;
+	}
+}
+
+/*
+ * PRINT CHANGE
+ * Prints a change. Tasks are printed with their current description, which
+ * never changes after they're created.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the change is printed to.
+ *     - Kanban *k: pointer to Kanban.
+ *     - Change *c: pointer to the change.
+ * RETURN (void).
+ */
+void print_change(Stream *s, Kanban *k, Change *c)
+{
+	Task *t;
+
+	switch (c->kind) {
+		case CHANGE_NEW_TASK:
+			t = &k->tasks.task[c->id - 1];
+			reply(s, STATUS_OK, STR_CHANGE_NEW_TASK, c->seq,
+				  STR_CHANGE_KIND_NEW_TASK, c->id, t->duration,
+				  t->description);
+			break;
+		case CHANGE_MOVE_TASK:
+			reply(s, STATUS_OK, STR_CHANGE_MOVE_TASK, c->seq,
+				  STR_CHANGE_KIND_MOVE_TASK, c->id,
+				  c->from_user == NO_USER ? STR_NO_USER
+										  : k->users.user[c->from_user],
+				  c->from_activity, k->users.user[c->to_user],
+				  c->to_activity);
+			break;
+		case CHANGE_ADVANCE_TIME:
+			reply(s, STATUS_OK, STR_CHANGE_ADVANCE_TIME, c->seq,
+				  STR_CHANGE_KIND_ADVANCE_TIME, c->now);
+			break;
+		case CHANGE_NEW_USER:
+			reply(s, STATUS_OK, STR_CHANGE_NEW_USER, c->seq,
+				  STR_CHANGE_KIND_NEW_USER, k->users.user[c->to_user]);
+			break;
+		case CHANGE_NEW_ACTIVITY:
+			reply(s, STATUS_OK, STR_CHANGE_NEW_ACTIVITY, c->seq,
+				  STR_CHANGE_KIND_NEW_ACTIVITY, c->to_activity,
+				  k->activities.activity[c->to_activity]);
+			break;
+	}
+}
+
+/*
+ * FREE SUBSCRIBERS
+ * Releases a subscriber list and the rings of its subscribers.
+ *
+ * ARGS:
+ *     - SubscriberList *l: pointer to the subscriber list.
+ * RETURN (void).
+ */
+void free_subscribers(SubscriberList *l)
+{
+	int i;
+
+	for (i = 0; i < l->amount; i++)
+		free(l->subscriber[i].change);
+
+	free(l->subscriber);
+	free(l);
+}
+
+
+/******************************************************************************
+ * REPORT FUNCTIONS                                                           *
+ ******************************************************************************/
+
+/*
+ * REPORT HANDLING
+ * Related command: R
+ * Reports totals across all boards: tasks per activity, total slack of the
+ * tasks in DONE and the users with most started tasks not yet done. Boards
+ * are scanned in parallel by the reporter threads, each into its own partial
+ * report, and the partial reports are merged in the end. Hibernated boards
+ * are scanned from their images, without waking them up.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the report is written to.
+ *     - BoardManager *m: pointer to the board manager.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int report(Stream *s, BoardManager *m)
+{
+	int i;
+
+	TRACE_BEGIN("report");
+
+	pthread_mutex_lock(&m->lock);
+
+	for (i = 0; i < m->amount; i++) {
+		while (m->board[i].state == BOARD_EVICTING)
+			pthread_cond_wait(&m->done, &m->lock);
+	}
+
+	for (i = 0; i < m->amount_reporters; i++)
+		setup_report(&m->report[i]);
+
+	m->report_next = 0;
+	m->report_pending = m->amount_reporters;
+	m->report_round++;
+	pthread_cond_broadcast(&m->report_work);
+
+	while (m->report_pending > 0)
+		pthread_cond_wait(&m->report_done, &m->lock);
+
+	pthread_mutex_unlock(&m->lock);
+
+	for (i = 1; i < m->amount_reporters; i++)
+		merge_report(&m->report[0], &m->report[i]);
+
+	if (m->report[0].failed)
+		reply(s, STATUS_CANNOT_REPORT, STR_FAIL_REPORT);
+	else
+		print_report(s, &m->report[0]);
+
+	for (i = 0; i < m->amount_reporters; i++)
+		free_report(&m->report[i]);
+
+	TRACE_END("report", m->amount);
+
+	return KEEP_GOING;
+}
+
+/*
+ * SCAN BOARDS
+ * Body of a reporter thread: on every report, takes boards to scan until
+ * there are none left. The command thread waits for the report, so resident
+ * boards don't change while they're scanned.
+ *
+ * ARGS:
+ *     - void *arg: pointer to the board manager.
+ * RETURN (void *):
+ *     - NULL.
+ */
+void *scan_boards(void *arg)
+{
+	int i, state;
+	unsigned long round = 0;
+	char path[BOARD_PATH_SZ];
+	BoardManager *m = arg;
+	Report *r;
+	Kanban *k, *image = NULL;
+
+	pthread_mutex_lock(&m->lock);
+	r = &m->report[m->report_ids++];
+
+	while (1) {
+		while (!m->stopping && round == m->report_round)
+			pthread_cond_wait(&m->report_work, &m->lock);
+		if (m->stopping)
+			break;
+		round = m->report_round;
+
+		while ((i = m->report_next) < m->amount) {
+			m->report_next++;
+			state = m->board[i].state;
+			k = m->board[i].k;
+			board_path(m, i, path);
+			pthread_mutex_unlock(&m->lock);
+
+			TRACE_BEGIN("scan_board");
+			if (state != BOARD_HIBERNATED)
+				scan_board(k, r);
+			else if ((image != NULL || (image = alloc_kanban()))
+					 && load_board(image, path)) {
+				scan_board(image, r);
+				free_history(&image->tasks);
+				free_users(&image->users);
+			} else
+				r->failed = 1;
+			TRACE_END("scan_board", i);
+
+			pthread_mutex_lock(&m->lock);
+		}
+
+		if (--m->report_pending == 0)
+			pthread_cond_signal(&m->report_done);
+	}
+
+	pthread_mutex_unlock(&m->lock);
+	free(image);
+
+	return NULL;
+}
+
+/*
+ * SCAN BOARD
+ * Adds a board's aggregates to a report.
+ *
+ * ARGS:
+ *     - Kanban *k: pointer to the board's Kanban.
+ *     - Report *r: pointer to the report.
+ * RETURN (void).
+ */
+void scan_board(Kanban *k, Report *r)
+{
+	int i, activity, in_activity[AMT_ACTIVITIES] = {0};
+	Task *t;
+
+	r->boards++;
+
+	for (i = 0; i < k->tasks.amount; i++) {
+		t = &k->tasks.task[i];
+		activity = find_activity(&k->activities, t->activity);
+		in_activity[activity]++;
+
+		if (activity == DONE)
+			r->slack += t->finish - t->start - t->duration;
+		else if (activity != TO_DO && activity != DONE)
+			add_count(r, &r->users, t->user, 1);
+	}
+
+	for (i = 0; i < k->activities.amount; i++)
+		add_count(r, &r->activities, k->activities.activity[i],
+				  in_activity[i]);
+}
+
+/*
+ * SETUP REPORT
+ * Setups an empty report.
+ *
+ * ARGS:
+ *     - Report *r: pointer to the report.
+ * RETURN (void).
+ */
+void setup_report(Report *r)
+{
+	r->boards = 0;
+	r->slack = 0;
+	r->failed = 0;
+	r->activities.slot = NULL;
+	r->activities.amount = 0;
+	r->activities.amount_slots = 0;
+	r->users.slot = NULL;
+	r->users.amount = 0;
+	r->users.amount_slots = 0;
+}
+
+/*
+ * FREE REPORT
+ * Releases the tallies of a report.
+ *
+ * ARGS:
+ *     - Report *r: pointer to the report.
+ * RETURN (void).
+ */
+void free_report(Report *r)
+{
+	free(r->activities.slot);
+	free(r->users.slot);
+}
+
+/*
+ * MERGE REPORT
+ * Adds a partial report to another.
+ *
+ * ARGS:
+ *     - Report *into: pointer to the report that is added to.
+ *     - Report *from: pointer to the partial report.
+ * RETURN (void).
+ */
+void merge_report(Report *into, Report *from)
+{
+	int i;
+
+	into->boards += from->boards;
+	into->slack += from->slack;
+	into->failed |= from->failed;
+
+	for (i = 0; i < from->activities.amount_slots; i++) {
+		if (from->activities.slot[i].name[0] != '\0')
+			add_count(into, &into->activities, from->activities.slot[i].name,
+					  from->activities.slot[i].amount);
+	}
+
+	for (i = 0; i < from->users.amount_slots; i++) {
+		if (from->users.slot[i].name[0] != '\0')
+			add_count(into, &into->users, from->users.slot[i].name,
+					  from->users.slot[i].amount);
+	}
+}
+
+/*
+ * PRINT REPORT
+ * Prints a report: the amount of boards, the amount of tasks in each
+ * activity by name, the total slack and the REPORT_TOP_USERS users with most
+ * started tasks not yet done. Sorts the tallies in place.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the report is printed to.
+ *     - Report *r: pointer to the report.
+ * RETURN (void).
+ */
+void print_report(Stream *s, Report *r)
+{
+	int i;
+	Count *c;
+
+	reply(s, STATUS_OK, STR_REPORT_BOARDS, STR_REPORT_KIND_BOARDS, r->boards);
+
+	if (r->activities.amount > 0)
+		qsort(r->activities.slot, r->activities.amount_slots, sizeof(Count),
+			  compare_counts_by_name);
+	for (i = 0; i < r->activities.amount; i++) {
+		c = &r->activities.slot[i];
+		reply(s, STATUS_OK, STR_REPORT_ACTIVITY, STR_REPORT_KIND_ACTIVITY,
+			  c->amount, c->name);
+	}
+
+	reply(s, STATUS_OK, STR_REPORT_SLACK, STR_REPORT_KIND_SLACK, r->slack);
+
+	if (r->users.amount > 0)
+		qsort(r->users.slot, r->users.amount_slots, sizeof(Count),
+			  compare_counts_by_amount);
+	for (i = 0; i < r->users.amount && i < REPORT_TOP_USERS; i++) {
+		c = &r->users.slot[i];
+		reply(s, STATUS_OK, STR_REPORT_USER, STR_REPORT_KIND_USER,
+			  c->amount, c->name);
+	}
+}
+
+/*
+ * ADD COUNT
+ * Adds an amount to the count of a name in a tally, growing the tally when
+ * it's half full. Marks the report as failed if there's no memory.
+ *
+ * ARGS:
+ *     - Report *r: pointer to the report the tally is in.
+ *     - Tally *t: pointer to the tally.
+ *     - const char name[]: name of the count.
+ *     - int amount: amount to be added.
+ * RETURN (void).
+ */
+void add_count(Report *r, Tally *t, const char name[], int amount)
+{
+	int i;
+	unsigned long h;
+	Count *slot;
+	Tally grown;
+
+	if (t->amount * 2 >= t->amount_slots) {
+		grown.amount = 0;
+		grown.amount_slots = t->amount_slots > 0 ? t->amount_slots * 2
+												 : REPORT_INITIAL_SLOTS;
+		if ((grown.slot = calloc(grown.amount_slots, sizeof(Count))) == NULL) {
+			r->failed = 1;
+			return;
+		}
+
+		for (i = 0; i < t->amount_slots; i++) {
+			if (t->slot[i].name[0] != '\0')
+				add_count(r, &grown, t->slot[i].name, t->slot[i].amount);
+		}
+
+		free(t->slot);
+		*t = grown;
+	}
+
+	h = hash_str(name);
+	while (t->slot[h & (t->amount_slots - 1)].name[0] != '\0' &&
+		   strcmp(t->slot[h & (t->amount_slots - 1)].name, name) != EQUAL)
+		h++;
+
+	slot = &t->slot[h & (t->amount_slots - 1)];
+	if (slot->name[0] == '\0') {
+		strcpy(slot->name, name);
+		t->amount++;
+	}
+	slot->amount += amount;
+}
+
+/*
+ * COMPARE COUNTS BY NAME
+ * Orders counts by name, free slots last. Used with qsort().
+ *
+ * ARGS:
+ *     - const void *a, *b: pointers to the counts.
+ * RETURN (int):
+ *     - negative if a comes first, positive if b does, 0 if they're equal.
+ */
+int compare_counts_by_name(const void *a, const void *b)
+{
+	const Count *x = a, *y = b;
+
+	if (x->name[0] == '\0' || y->name[0] == '\0')
+		return (x->name[0] == '\0') - (y->name[0] == '\0');
+
+	return strcmp(x->name, y->name);
+}
+
+/*
+ * COMPARE COUNTS BY AMOUNT
+ * Orders counts by decreasing amount, then name, free slots last. Used with
+ * qsort().
+ *
+ * ARGS:
+ *     - const void *a, *b: pointers to the counts.
+ * RETURN (int):
+ *     - negative if a comes first, positive if b does, 0 if they're equal.
+ */
+int compare_counts_by_amount(const void *a, const void *b)
+{
+	const Count *x = a, *y = b;
+
+	if (x->name[0] == '\0' || y->name[0] == '\0' || x->amount == y->amount)
+		return compare_counts_by_name(a, b);
+
+	return x->amount > y->amount ? -1 : 1;
+}
+
+
+/******************************************************************************
+ * COMMAND HANDLING FUNCTIONS                                                 *
+ ******************************************************************************/
+
+/*
+ * NEW TASK HANDLING
+ * Related command: t <duration> <descritption>
+ * Adds a new task to the kanban.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - Kanban *k: pointer to Kanban.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int new_task(Stream *s, Kanban *k)
+{
+	TaskList *l = &k->tasks;
+	Task t;
+	Change c;
+
+	read_description(s, &t);
+	strcpy(t.activity, STR_TO_DO);
+	t.start = 0;
+	t.finish = 0;
+	t.history = NULL;
+	t.history_sz = 0;
+
+	if (TRACE_CALL(is_new_task_valid, (s, l, &t))) {
+		append_task(l, &t);
+		append_transition(l, &l->task[l->amount - 1], k->now, TO_DO, NO_USER);
+		l->ordered_by_description[l->amount - 1] = l->amount - 1;
+		if (l->amount - l->amount_sorted >= MAX_UNSORTED_TASKS)
+			sort_descriptions(l);
+		l->version++;
+		touch_activity(k, STR_TO_DO);
+
+		c.kind = CHANGE_NEW_TASK;
+		c.id = l->amount;
+		publish(k, &c);
+
+		reply(s, STATUS_OK, STR_SUCCESS_NEW_TASK, l->amount);
+	}
+
+	return KEEP_GOING;
+}
+
+/*
+ * LIST TASKS HANDLING
+ * Related command: l [<id> <id> ...]
+ * Lists tasks in kanban. The listing of all tasks is cached until a task
+ * changes, only then are new tasks sorted by description.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - TaskList *l: pointer to the Kanban's task list.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int list_tasks(Stream *s, TaskList *l, int has_args)
+{
+	int i, id;
+	FILE *out;
+
+	if (has_args && s->binary) {
+		while (decode_int(s, &id)) {
+			if (TRACE_CALL(is_id_valid, (s, l, id)))
+				print_task(s, l, id);
+		}
+	} else if (has_args) {
+		while (fscanf(s->in, STR_MATCH_SINGLE_TASK_ID, &id) == 1) {
+			if (TRACE_CALL(is_id_valid, (s, l, id)))
+				print_task(s, l, id);
+		}
+	} else if (!replay_cache(s, &l->cache, l->version)) {
+		out = begin_cache(s, &l->cache);
+		sort_descriptions(l);
+		for (i = 0; i < l->amount; i++) {
+			id = l->ordered_by_description[i] + 1;
+			if (TRACE_CALL(is_id_valid, (s, l, id)))
+				print_task(s, l, id);
+		}
+		end_cache(s, &l->cache, out, l->version);
+	}
+
+	return KEEP_GOING;
+}
+
+/*
+ * ADVANCE TIME HANDLING
+ * Related command: n <duration>
+ * Advance the kanban's current time.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - Kanban *k: pointer to Kanban.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int advance_time(Stream *s, Kanban *k)
+{
+	int time;
+	Change c;
+
+	if (s->binary)
+		decode_int(s, &time);
+	else
+		fscanf(s->in, STR_MATCH_TIME_INCREMENT, &time);
+
+	if (TRACE_CALL(is_time_valid, (s, time))) {
+		k->now += time;
+		if (time > 0)
+			k->tasks.first_at_current_time = k->tasks.amount_started;
+
+		c.kind = CHANGE_ADVANCE_TIME;
+		c.now = k->now;
+		publish(k, &c);
+
+		reply(s, STATUS_OK, STR_SUCCESS_ADVANCE_TIME, k->now);
+	}
+
+	return KEEP_GOING;
+}
+
+/*
+ * USER HANDLING
+ * Related command: u [<user>]
+ * Handles the user command.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - Kanban *k: pointer to Kanban.
+ *     - char has_args: true if the user input has further arguments.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int handle_users(Stream *s, Kanban *k, int has_args)
+{
+	if (has_args)
+		return new_user(s, k);
+	else
+		return list_users(s, &k->users);
+}
+
+/*
+ * NEW USER HANDLING
+ * Related command: u <user>
+ * Adds new user to kanban.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - Kanban *k: pointer to Kanban.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int new_user(Stream *s, Kanban *k)
+{
+	char user[USER_SZ];
+	UserList *l = &k->users;
+	Change c;
+
+	if (s->binary)
+		decode_word(s, user, USER_SZ);
+	else
+		fscanf(s->in, STR_MATCH_NEW_USER, user);
+
+	if (TRACE_CALL(is_new_user_valid, (s, l, user))) {
+		if (!append_user(l, user)) {
+			reply(s, STATUS_TOO_MANY_USERS, STR_FAIL_NEW_USER_TOO_MANY_USERS);
+			return KEEP_GOING;
+		}
+
+		c.kind = CHANGE_NEW_USER;
+		c.to_user = l->amount - 1;
+		publish(k, &c);
+	}
+
+	return KEEP_GOING;
+}
+
+/*
+ * LIST USERS HANDLING
+ * Related command: u
+ * Lists users in kanban.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the reply is written to.
+ *     - UserList *l: pointer to the Kanban's user list.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int list_users(Stream *s, UserList *l)
+{
+	int i;
+
+	for (i = 0; i < l->amount; i++)
+		reply(s, STATUS_OK, STR_SUCCESS_LIST_USERS, l->user[i]);
+
+	return KEEP_GOING;
+}
+
+/*
+ * MOVE TASK HANDLING
+ * Related command: m <id> <user> <activity>
+ * Moves task between activities.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - Kanban *k: pointer to Kanban.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int move_task(Stream *s, Kanban *k)
+{
+	int id;
+	char user[USER_SZ], activity[ACTIVITY_SZ];
+	read_move(s, &id, user, activity);
+
+	if (TRACE_CALL(is_move_valid, (s, k, id, user, activity))) {
+		if (strcmp(k->tasks.task[id - 1].activity, STR_TO_DO) == EQUAL) {
+			k->tasks.task[id - 1].start = k->now;
+			binary_insert(&k->tasks, k->tasks.ordered_by_start, id,
+						  k->tasks.first_at_current_time,
+						  k->tasks.amount_started - 1);
+			k->tasks.amount_started++;
+		}
+		relocate_task(s, k, id, user, activity);
+	}
+
+	return KEEP_GOING;
+}
+
+/*
+ * BATCH MOVE TASKS HANDLING
+ * Related command: M <amount>
+ *                  <id> <user> <activity>  (repeated <amount> times)
+ * Moves several tasks between activities. Tasks started by the batch are
+ * only inserted into the start order once the whole batch is applied. The
+ * batch stops early if the input runs out before <amount> moves are read.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - Kanban *k: pointer to Kanban.
+ *     - char has_args: true if the user input has further arguments.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int batch_move_tasks(Stream *s, Kanban *k, int has_args)
+{
+	int i, amount = -1, id, amount_pending = 0;
+	int pending[AMT_TASKS], tmp[AMT_TASKS];
+	char user[USER_SZ], activity[ACTIVITY_SZ];
+
+	if (has_args && s->binary)
+		decode_int(s, &amount);
+	else if (has_args && fscanf(s->in, STR_MATCH_BATCH_SIZE, &amount) != 1) {
+		fscanf(s->in, STR_MATCH_REST_OF_LINE);
+		amount = -1;
+	}
+
+	if (!TRACE_CALL(is_batch_size_valid, (s, amount)))
+		return KEEP_GOING;
+
+	for (i = 0; i < amount && read_move(s, &id, user, activity); i++) {
+		if (TRACE_CALL(is_move_valid, (s, k, id, user, activity))) {
+			if (strcmp(k->tasks.task[id - 1].activity, STR_TO_DO) == EQUAL) {
+				k->tasks.task[id - 1].start = k->now;
+				pending[amount_pending++] = id - 1;
+			}
+			relocate_task(s, k, id, user, activity);
+		}
+	}
+
+	merge_sort(&k->tasks, pending, tmp, amount_pending);
+	merge_insert(&k->tasks, k->tasks.ordered_by_start, pending, amount_pending,
+				 k->tasks.first_at_current_time, k->tasks.amount_started - 1);
+	k->tasks.amount_started += amount_pending;
+
+	return KEEP_GOING;
+}
+
+/*
+ * DISPLAY ACTIVITY HANDLING
+ * Related command: d <activity>
+ * List all tasks in activity. The listing is cached until a task enters,
+ * leaves or is added to the activity.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - Kanban *k: pointer to Kanban.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int display_activity(Stream *s, Kanban *k)
+{
+	int i;
+	char activity[ACTIVITY_SZ];
+	ResultCache *c;
+	FILE *out;
+	read_activity(s, activity);
+
+	if (!TRACE_CALL(is_activity_valid, (s, &k->activities, activity)))
+		return KEEP_GOING;
+
+	i = find_activity(&k->activities, activity);
+	c = &k->activities.cache[i];
+
+	if (!replay_cache(s, c, k->activities.version[i])) {
+		out = begin_cache(s, c);
+		if (strcmp(activity, STR_TO_DO) == EQUAL) {
+			sort_descriptions(&k->tasks);
+			print_activity(s, k, activity,
+						   k->tasks.ordered_by_description, k->tasks.amount);
+		} else
+			print_activity(s, k, activity,
+						   k->tasks.ordered_by_start, k->tasks.amount_started);
+		end_cache(s, c, out, k->activities.version[i]);
+	}
+
+	return KEEP_GOING;
+}
+
+/*
+ * LIST TASKS PAGE HANDLING
+ * Related command: L <page size> <cursor>
+ * Lists up to <page size> tasks in description order, following the task
+ * with id <cursor> (0 for the first page), then the cursor of the next page
+ * (0 if there are no more). A task inserted behind the cursor is skipped and
+ * one inserted ahead of it is listed, none is ever listed twice.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - TaskList *l: pointer to the Kanban's task list.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int list_tasks_page(Stream *s, TaskList *l)
+{
+	int i = 0, page_sz, cursor;
+
+	if (s->binary) {
+		decode_int(s, &page_sz);
+		decode_int(s, &cursor);
+	} else
+		fscanf(s->in, STR_MATCH_PAGE, &page_sz, &cursor);
+
+	if (TRACE_CALL(is_page_valid, (s, l, page_sz, cursor))) {
+		sort_descriptions(l);
+		if (cursor > 0)
+			i = binary_search(l, l->ordered_by_description, cursor,
+							  0, l->amount - 1, compare_descriptions);
+
+		for (; i < l->amount && page_sz > 0; i++, page_sz--)
+			print_task(s, l, l->ordered_by_description[i] + 1);
+
+		cursor = i < l->amount ? l->ordered_by_description[i - 1] + 1 : 0;
+		reply(s, STATUS_OK, STR_SUCCESS_PAGE_CURSOR, cursor);
+	}
+
+	return KEEP_GOING;
+}
+
+/*
+ * DISPLAY ACTIVITY PAGE HANDLING
+ * Related command: D <page size> <cursor> <activity>
+ * Lists up to <page size> tasks in activity, following the task with id
+ * <cursor> (0 for the first page), then the cursor of the next page (0 if
+ * there are no more).
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - Kanban *k: pointer to Kanban.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int display_activity_page(Stream *s, Kanban *k)
+{
+	int i = 0, page_sz, cursor;
+	char activity[ACTIVITY_SZ];
+
+	if (s->binary) {
+		decode_int(s, &page_sz);
+		decode_int(s, &cursor);
+		decode_word(s, activity, ACTIVITY_SZ);
+	} else
+		fscanf(s->in, STR_MATCH_ACTIVITY_PAGE, &page_sz, &cursor, activity);
+
+	if (TRACE_CALL(is_activity_valid, (s, &k->activities, activity)) &&
+		TRACE_CALL(is_page_valid, (s, &k->tasks, page_sz, cursor))) {
+		if (strcmp(activity, STR_TO_DO) == EQUAL) {
+			sort_descriptions(&k->tasks);
+			if (cursor > 0)
+				i = binary_search(&k->tasks, k->tasks.ordered_by_description,
+								  cursor, 0, k->tasks.amount - 1,
+								  compare_descriptions);
+			cursor = print_activity_page(s, k, activity,
+										 k->tasks.ordered_by_description,
+										 k->tasks.amount, i, page_sz);
+		} else {
+			if (cursor > 0)
+				i = binary_search(&k->tasks, k->tasks.ordered_by_start,
+								  cursor, 0, k->tasks.amount_started - 1,
+								  compare_starts);
+			cursor = print_activity_page(s, k, activity,
+										 k->tasks.ordered_by_start,
+										 k->tasks.amount_started, i, page_sz);
+		}
+
+		reply(s, STATUS_OK, STR_SUCCESS_PAGE_CURSOR, cursor);
+	}
+
+	return KEEP_GOING;
+}
+
+/*
+ * ACTIVITY HANDLING
+ * Related command: a [<activity>]
+ * Handles the activity command.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - Kanban *k: pointer to Kanban.
+ *     - char has_args: true if the user input has further arguments.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int handle_activities(Stream *s, Kanban *k, int has_args)
+{
+	if (has_args)
+		return new_activity(s, k);
+	else
+		return list_activities(s, &k->activities);
+}
+
+/*
+ * NEW ACTIVITY HANDLING
+ * Related command: a <activity>
+ * Adds new activity to kanban.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - Kanban *k: pointer to Kanban.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int new_activity(Stream *s, Kanban *k)
+{
+	char activity[ACTIVITY_SZ];
+	ActivityList *l = &k->activities;
+	Change c;
+	read_activity(s, activity);
+
+	if (TRACE_CALL(is_new_activity_valid, (s, l, activity))) {
+		append_activity(l, activity);
+		l->version[l->amount - 1]++;
+
+		c.kind = CHANGE_NEW_ACTIVITY;
+		c.to_activity = l->amount - 1;
+		publish(k, &c);
+	}
+
+	return KEEP_GOING;
+}
+
+/*
+ * LIST ACTIVITIES HANDLING
+ * Related command: a
+ * Lists activities in kanban.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the reply is written to.
+ *     - ActivityList *l: pointer to the Kanban's activity list.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int list_activities(Stream *s, ActivityList *l)
+{
+	int i;
+
+	for(i = 0; i < l->amount; i++)
+		reply(s, STATUS_OK, STR_SUCCESS_LIST_ACTIVITIES, l->activity[i]);
+
+	return KEEP_GOING;
+}
+
+/*
+ * SUBSCRIBE HANDLING
+ * Related command: s <ring size>
+ * Adds a subscriber to the kanban, that will receive the changes made from
+ * now on. Up to <ring size> changes are kept for it.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - Kanban *k: pointer to Kanban.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int subscribe(Stream *s, Kanban *k)
+{
+	int ring_sz, capacity;
+	SubscriberList *l = k->subscribers;
+	Subscriber *sub;
+
+	if (s->binary)
+		decode_int(s, &ring_sz);
+	else
+		fscanf(s->in, STR_MATCH_RING_SIZE, &ring_sz);
+
+	if (!TRACE_CALL(is_ring_size_valid, (s, k, ring_sz)))
+		return KEEP_GOING;
+
+	if (l->amount == l->capacity) {
+		capacity = l->capacity > 0 ? l->capacity * 2 : SUBSCRIBERS_INITIAL_SZ;
+		sub = realloc(l->subscriber, sizeof(Subscriber) * capacity);
+		if (sub == NULL) {
+			reply(s, STATUS_CANNOT_SUBSCRIBE, STR_FAIL_SUBSCRIBE);
+			return KEEP_GOING;
+		}
+		l->subscriber = sub;
+		l->capacity = capacity;
+	}
+
+	sub = &l->subscriber[l->amount];
+	if ((sub->change = malloc(sizeof(Change) * ring_sz)) == NULL) {
+		reply(s, STATUS_CANNOT_SUBSCRIBE, STR_FAIL_SUBSCRIBE);
+		return KEEP_GOING;
+	}
+	sub->ring_sz = ring_sz;
+	sub->next = l->seq + 1;
+
+	reply(s, STATUS_OK, STR_SUCCESS_SUBSCRIBE, ++l->amount);
+
+	return KEEP_GOING;
+}
+
+/*
+ * READ CHANGES HANDLING
+ * Related command: e <subscriber> <amount>
+ * Delivers up to <amount> pending changes to a subscriber, oldest first. If
+ * changes were overwritten before being delivered, a gap with the sequence
+ * numbers of the first and last lost changes is delivered first, so the
+ * subscriber knows to resync from the listing commands.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - Kanban *k: pointer to Kanban.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int read_changes(Stream *s, Kanban *k)
+{
+	int id, amount;
+	unsigned int oldest;
+	Subscriber *sub;
+	SubscriberList *l = k->subscribers;
+
+	if (s->binary) {
+		decode_int(s, &id);
+		decode_int(s, &amount);
+	} else
+		fscanf(s->in, STR_MATCH_READ_CHANGES, &id, &amount);
+
+	if (!TRACE_CALL(is_subscriber_valid, (s, k, id)))
+		return KEEP_GOING;
+
+	sub = &l->subscriber[id - 1];
+	if (l->seq < (unsigned int) sub->ring_sz)
+		oldest = 1;
+	else
+		oldest = l->seq - sub->ring_sz + 1;
+
+	if (sub->next < oldest) {
+		reply(s, STATUS_OK, STR_CHANGE_GAP, sub->next, STR_CHANGE_KIND_GAP,
+			  oldest - 1);
+		sub->next = oldest;
+	}
+
+	for (; sub->next <= l->seq && amount > 0; sub->next++, amount--)
+		print_change(s, k, &sub->change[sub->next % sub->ring_sz]);
+
+	return KEEP_GOING;
+}
+
+/*
+ * UNSUBSCRIBE HANDLING
+ * Related command: x <subscriber>
+ * Removes a subscriber from the kanban. Its id is not reused.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - Kanban *k: pointer to Kanban.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int unsubscribe(Stream *s, Kanban *k)
+{
+	int id;
+
+	if (s->binary)
+		decode_int(s, &id);
+	else
+		fscanf(s->in, STR_MATCH_SUBSCRIBER, &id);
+
+	if (TRACE_CALL(is_subscriber_valid, (s, k, id))) {
+		free(k->subscribers->subscriber[id - 1].change);
+		k->subscribers->subscriber[id - 1].change = NULL;
+	}
+
+	return KEEP_GOING;
+}
+
+/*
+ * DISPLAY ACTIVITY AT TIME HANDLING
+ * Related command: h <time> <activity>
+ * List the tasks that were in an activity at a past moment, the same way as
+ * display_activity().
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - Kanban *k: pointer to Kanban.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int display_activity_at(Stream *s, Kanban *k)
+{
+	int time;
+	char activity[ACTIVITY_SZ];
+
+	if (s->binary)
+		decode_int(s, &time);
+	else
+		fscanf(s->in, STR_MATCH_PAST_TIME, &time);
+	read_activity(s, activity);
+
+	if (TRACE_CALL(is_past_time_valid, (s, k, time)) &&
+		TRACE_CALL(is_activity_valid, (s, &k->activities, activity))) {
+		if (strcmp(activity, STR_TO_DO) == EQUAL) {
+			sort_descriptions(&k->tasks);
+			print_activity_at(s, k, TO_DO, k->tasks.ordered_by_description,
+							  k->tasks.amount, time);
+		} else
+			print_activity_at(s, k, find_activity(&k->activities, activity),
+							  k->tasks.ordered_by_start,
+							  k->tasks.amount_started, time);
+	}
+
+	return KEEP_GOING;
+}
+
+/*
+ * TASK AT TIME HANDLING
+ * Related command: H <time> <id>
+ * Prints the user and activity a task had at a past moment.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - Kanban *k: pointer to Kanban.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int task_at(Stream *s, Kanban *k)
+{
+	int time, id;
+	Transition state;
+
+	if (s->binary) {
+		decode_int(s, &time);
+		decode_int(s, &id);
+	} else
+		fscanf(s->in, STR_MATCH_TASK_AT, &time, &id);
+
+	if (!TRACE_CALL(is_past_time_valid, (s, k, time)))
+		return KEEP_GOING;
+
+	if (id < 1 || id > k->tasks.amount ||
+		!find_state(k, &k->tasks.task[id - 1], time, &state)) {
+		reply(s, STATUS_NO_SUCH_TASK, STR_FAIL_LIST_TASKS_NO_SUCH_TASK, id);
+		return KEEP_GOING;
+	}
+
+	reply(s, STATUS_OK, STR_SUCCESS_TASK_AT, id,
+		  state.user == NO_USER ? STR_NO_USER : k->users.user[state.user],
+		  k->activities.activity[state.activity]);
+
+	return KEEP_GOING;
+}
+
+/*
+ * LIST USER TASKS HANDLING
+ * Related command: w <user>
+ * Lists the tasks assigned to a user, grouped by activity and ordered by
+ * start time, then description. Only goes through the user's task index,
+ * rebuilding it first if it was lost.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ *     - Kanban *k: pointer to Kanban.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int list_user_tasks(Stream *s, Kanban *k)
+{
+	int i, j, owner;
+	char user[USER_SZ];
+	UserTasks *u;
+	Task *t;
+
+	if (s->binary)
+		decode_word(s, user, USER_SZ);
+	else
+		fscanf(s->in, STR_MATCH_USER_TASKS, user);
+
+	if (!TRACE_CALL(is_user_tasks_valid, (s, k, user)))
+		return KEEP_GOING;
+
+	owner = find_user(&k->users, user);
+	u = &k->users.tasks[owner];
+
+	if (u->amount == NO_INDEX &&
+		!rebuild_user_tasks(&k->users, &k->tasks, owner)) {
+		reply(s, STATUS_CANNOT_LIST_USER_TASKS, STR_FAIL_USER_TASKS);
+		return KEEP_GOING;
+	}
+
+	for (i = 0; i < k->activities.amount; i++) {
+		for (j = 0; j < u->amount; j++) {
+			t = &k->tasks.task[u->order[j]];
+			if (strcmp(t->activity, k->activities.activity[i]) == EQUAL)
+				reply(s, STATUS_OK, STR_SUCCESS_USER_TASKS, u->order[j] + 1,
+					  t->activity, t->start, t->description);
+		}
+	}
+
+	return KEEP_GOING;
+}
+
+
+/******************************************************************************
+ * AUXILIARY COMMAND FUNCTIONS                                                *
+ ******************************************************************************/
+
+/*
+ * RELOCATE TASK
+ * Assigns a task to a user and activity, after the move has been validated,
+ * moving it between the users' task indices if the user changes. Prints the
+ * duration and slack if the task was moved to DONE.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the reply is written to.
+ *     - Kanban *k: pointer to Kanban.
+ *     - int id: id of the task that will be moved.
+ *     - char user[]: user string the task will be assigned to.
+ *     - char activity[]: activity string the task will be moved to.
+ * RETURN (void).
+ */
+void relocate_task(Stream *s, Kanban *k, int id, char user[], char activity[])
+{
+	int real_duration, slack;
+	Change c;
+
+	c.kind = CHANGE_MOVE_TASK;
+	c.id = id;
+	c.from_activity = find_activity(&k->activities,
+									k->tasks.task[id - 1].activity);
+	c.from_user = c.from_activity == TO_DO ? NO_USER
+					: find_user(&k->users, k->tasks.task[id - 1].user);
+	c.to_activity = find_activity(&k->activities, activity);
+	c.to_user = find_user(&k->users, user);
+	publish(k, &c);
+	append_transition(&k->tasks, &k->tasks.task[id - 1], k->now,
+					  c.to_activity, c.to_user);
+
+	if (c.from_user != c.to_user) {
+		if (c.from_user != NO_USER)
+			unassign_task(&k->users, &k->tasks, c.from_user, id);
+		assign_task(&k->users, &k->tasks, c.to_user, id);
+	}
+
+	touch_activity(k, k->tasks.task[id - 1].activity);
+	touch_activity(k, activity);
+	k->tasks.version++;
+
+	strcpy(k->tasks.task[id - 1].user, user);
+	strcpy(k->tasks.task[id - 1].activity, activity);
+
+	if (strcmp(activity, STR_DONE) == EQUAL) {
+		k->tasks.task[id - 1].finish = k->now;
+		real_duration = k->now - k->tasks.task[id - 1].start;
+		slack = real_duration - k->tasks.task[id - 1].duration;
+		reply(s, STATUS_OK, STR_SUCCESS_MOVE_TASK_TO_DONE,
+			  real_duration, slack);
+	}
+}
+
+/*
+ * TOUCH ACTIVITY
+ * Bumps the version of an activity, making its cached listing stale.
+ *
+ * ARGS:
+ *     - Kanban *k: pointer to Kanban.
+ *     - char activity[]: string of the activity.
+ * RETURN (void).
+ */
+void touch_activity(Kanban *k, char activity[])
+{
+	k->activities.version[find_activity(&k->activities, activity)]++;
+}
+
+/*
+ * READ MOVE
+ * Reads the arguments of a move: <id> <user> <activity>
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the arguments are read from.
+ *     - int *id: where the id of the task is stored.
+ *     - char user[]: where the user string is stored.
+ *     - char activity[]: where the activity string is stored.
+ * RETURN (int):
+ *     - returns 1 if all the arguments were read, 0 if the input ran out.
+ */
+int read_move(Stream *s, int *id, char user[], char activity[])
+{
+	*id = 0;
+	user[0] = activity[0] = '\0';
+
+	if (s->binary)
+		return decode_int(s, id) && decode_word(s, user, USER_SZ) &&
+			   decode_word(s, activity, ACTIVITY_SZ);
+
+	return fscanf(s->in, STR_MATCH_TASK_MOVE, id, user, activity) == 3;
+}
+
+/*
+ * READ ACTIVITY
+ * Reads an activity argument, which takes the rest of the line in text mode.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the argument is read from.
+ *     - char activity[]: where the activity string is stored.
+ * RETURN (void).
+ */
+void read_activity(Stream *s, char activity[])
+{
+	if (s->binary)
+		decode_word(s, activity, ACTIVITY_SZ);
+	else
+		fscanf(s->in, STR_MATCH_ACTIVITY, activity);
+}
+
+
+/******************************************************************************
+ * ERROR CHECKING FUNCTIONS                                                   *
+ ******************************************************************************/
+
+/*
+ * CHECK NEW TASK
+ * Checks for the following errors related to the new task command:
+ *     - too many tasks.
+ *     - duplicate description.
+ *     - invalid duration.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream errors are written to.
+ *     - TaskList *l: pointer to the Kanban's task list.
+ *     - Task *t: pointer to the new task that will be checked.
+ * RETURN (int):
+ *     - returns 1 if there are no errors, 0 otherwise.
+ */
+int is_new_task_valid(Stream *s, TaskList *l, Task *t)
+{
+	if (l->amount >= AMT_TASKS)
+		reply(s, STATUS_TOO_MANY_TASKS, STR_FAIL_NEW_TASK_TOO_MANY_TASKS);
+	else if (is_task_description_duplicate(l, t))
+		reply(s, STATUS_DUPLICATE_DESCRIPTION,
+			  STR_FAIL_NEW_TASK_DUPLICATE_DESCRIPTION);
+	else if (t->duration <= 0)
+		reply(s, STATUS_INVALID_DURATION, STR_FAIL_NEW_TASK_INVALID_DURATION);
+	else
+		return 1;
+
+	return 0;
+}
+
+/*
+ * CHECK ID
+ * Checks for the following errors related to the list tasks command:
+ *     - <id>: no such task.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream errors are written to.
+ *     - TaskList *l: pointer to the Kanban's task list.
+ *     - int id: id to be checked.
+ * RETURN (int):
+ *     - returns 1 if there are no errors, 0 otherwise.
+ */
+int is_id_valid(Stream *s, TaskList *l, int id)
+{
+	if (id < 1 || id > l->amount)
+		reply(s, STATUS_NO_SUCH_TASK, STR_FAIL_LIST_TASKS_NO_SUCH_TASK, id);
+	else
+		return 1;
+
+	return 0;
+}
+
+/*
+ * CHECK TIME
+ * Checks for the following errors related to the advance time command:
+ *     - invalid time.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream errors are written to.
+ *     - int time: time integer to be checked.
+ * RETURN (int):
+ *     - returns 1 if there are no errors, 0 otherwise.
+ */
+int is_time_valid(Stream *s, int time)
+{
+	if (time < 0)
+		reply(s, STATUS_INVALID_TIME, STR_FAIL_ADVANCE_TIME_INVALID_TIME);
+	else
+		return 1;
+
+	return 0;
+}
+
+/*
+ * CHECK NEW USER
+ * Checks for the following errors related to the new user command:
+ *     - user already exists.
+ *     - too many users, only if the user list has a limit.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream errors are written to.
+ *     - UserList *l: pointer to the Kanban's user list.
+ *     - char user[]: user string to be checked.
+ * RETURN (int):
+ *     - returns 1 if there are no errors, 0 otherwise.
+ */
+int is_new_user_valid(Stream *s, UserList *l, char user[])
+{
+	if (is_existing_user(l, user))
+		reply(s, STATUS_USER_ALREADY_EXISTS,
+			  STR_FAIL_NEW_USER_USER_ALREADY_EXISTS);
+	else if (l->limit != NO_LIMIT && l->amount >= l->limit)
+		reply(s, STATUS_TOO_MANY_USERS, STR_FAIL_NEW_USER_TOO_MANY_USERS);
+	else
+		return 1;
+
+	return 0;
+}
+
+/*
+ * CHECK MOVE
+ * Checks for the following errors related to the move task command:
+ *     - no such task.
+ *     - same activity (doesn't print a message).
+ *     - task already started.
+ *     - no such user.
+ *     - no such activity.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream errors are written to.
+ *     - Kanban *k: pointer to Kanban.
+ *     - int id: id of task that will be moved.
+ *     - char user[]: user string to be checked.
+ *     - char activity[]: activity string to be checked.
+ * RETURN (int):
+ *     - returns 1 if there are no errors, 0 otherwise.
+ */
+int is_move_valid(Stream *s, Kanban *k, int id, char user[], char activity[])
+{
+	if (id < 1 || id > k->tasks.amount)
+		reply(s, STATUS_NO_SUCH_TASK, STR_FAIL_MOVE_TASK_NO_SUCH_TASK);
+	else if (strcmp(k->tasks.task[id - 1].activity, activity) == EQUAL)
+		return 0;
+	else if (strcmp(activity, STR_TO_DO) == EQUAL)
+		reply(s, STATUS_TASK_ALREADY_STARTED,
+			  STR_FAIL_MOVE_TASK_TASK_ALREADY_STARTED);
+	else if (!is_existing_user(&k->users, user))
+		reply(s, STATUS_NO_SUCH_USER, STR_FAIL_MOVE_TASK_NO_SUCH_USER);
+	else if (!is_existing_activity(&k->activities, activity))
+		reply(s, STATUS_NO_SUCH_ACTIVITY, STR_FAIL_MOVE_TASK_NO_SUCH_ACTIVITY);
+	else
+		return 1;
+
+	return 0;
+}
+
+/*
+ * CHECK RING SIZE
+ * Checks for the following errors related to the subscribe command:
+ *     - cannot subscribe (kanban can't have subscribers).
+ *     - invalid ring size.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream errors are written to.
+ *     - Kanban *k: pointer to Kanban.
+ *     - int ring_sz: ring size to be checked.
+ * RETURN (int):
+ *     - returns 1 if there are no errors, 0 otherwise.
+ */
+int is_ring_size_valid(Stream *s, Kanban *k, int ring_sz)
+{
+	if (k->subscribers == NULL)
+		reply(s, STATUS_CANNOT_SUBSCRIBE, STR_FAIL_SUBSCRIBE);
+	else if (ring_sz < 1 || ring_sz > MAX_RING_SZ)
+		reply(s, STATUS_INVALID_RING_SIZE,
+			  STR_FAIL_SUBSCRIBE_INVALID_RING_SIZE);
+	else
+		return 1;
+
+	return 0;
+}
+
+/*
+ * CHECK SUBSCRIBER
+ * Checks for the following errors related to the read changes and
+ * unsubscribe commands:
+ *     - no such subscriber.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream errors are written to.
+ *     - Kanban *k: pointer to Kanban.
+ *     - int id: subscriber id to be checked.
+ * RETURN (int):
+ *     - returns 1 if there are no errors, 0 otherwise.
+ */
+int is_subscriber_valid(Stream *s, Kanban *k, int id)
+{
+	if (k->subscribers == NULL || id < 1 || id > k->subscribers->amount ||
+		k->subscribers->subscriber[id - 1].change == NULL)
+		reply(s, STATUS_NO_SUCH_SUBSCRIBER, STR_FAIL_NO_SUCH_SUBSCRIBER);
+	else
+		return 1;
+
+	return 0;
+}
+
+/*
+ * CHECK PAST TIME
+ * Checks for the following errors related to the commands querying a past
+ * moment:
+ *     - invalid time (negative or in the future).
+ *     - history expired (some task's history at that moment is not kept).
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream errors are written to.
+ *     - Kanban *k: pointer to Kanban.
+ *     - int time: time integer to be checked.
+ * RETURN (int):
+ *     - returns 1 if there are no errors, 0 otherwise.
+ */
+int is_past_time_valid(Stream *s, Kanban *k, int time)
+{
+	if (time < 0 || (unsigned int) time > k->now)
+		reply(s, STATUS_INVALID_TIME, STR_FAIL_ADVANCE_TIME_INVALID_TIME);
+	else if ((unsigned int) time < k->tasks.history_horizon)
+		reply(s, STATUS_HISTORY_EXPIRED, STR_FAIL_HISTORY_EXPIRED);
+	else
+		return 1;
+
+	return 0;
+}
+
+/*
+ * CHECK USER TASKS
+ * Checks for the following errors related to the list user tasks command:
+ *     - no such user.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream errors are written to.
+ *     - Kanban *k: pointer to Kanban.
+ *     - char user[]: user string to be checked.
+ * RETURN (int):
+ *     - returns 1 if there are no errors, 0 otherwise.
+ */
+int is_user_tasks_valid(Stream *s, Kanban *k, char user[])
+{
+	int i = find_user(&k->users, user);
+
+	if (i == NO_USER)
+		reply(s, STATUS_NO_SUCH_USER, STR_FAIL_USER_TASKS_NO_SUCH_USER);
+	else
+		return 1;
+
+	return 0;
+}
+
+/*
+ * CHECK ACTIVITY
+ * Checks for the following errors related to the display activity command:
+ *     - no such activity.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream errors are written to.
+ *     - ActivityList *l: pointer to the Kanban's activity list.
+ *     - char activity[]: activity string to be checked.
+ * RETURN (int):
+ *     - returns 1 if there are no errors, 0 otherwise.
+ */
+int is_activity_valid(Stream *s, ActivityList *l, char activity[])
+{
+	if (!is_existing_activity(l, activity))
+		reply(s, STATUS_NO_SUCH_ACTIVITY,
+			  STR_FAIL_DISPLAY_ACTIVITY_NO_SUCH_ACTIVITY);
+	else
+		return 1;
+
+	return 0;
+}
+
+/*
+ * CHECK NEW ACTIVITY
+ * Checks for the following errors related to the new activity command:
+ *     - duplicate activity.
+ *     - invalid description.
+ *     - too many activities.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream errors are written to.
+ *     - ActivityList *l: pointer to the Kanban's activity list.
+ *     - char activity[]: activity string to be checked.
+ * RETURN (int):
+ *     - returns 1 if there are no errors, 0 otherwise.
+ */
+int is_new_activity_valid(Stream *s, ActivityList *l, char activity[])
+{
+	if (is_existing_activity(l, activity))
+		reply(s, STATUS_DUPLICATE_ACTIVITY,
+			  STR_FAIL_NEW_ACTIVITY_DUPLICATE_ACTIVITY);
+	else if (str_has_lowercase(activity))
+		reply(s, STATUS_INVALID_DESCRIPTION,
+			  STR_FAIL_NEW_ACTIVITY_INVALID_DESCRIPTION);
+	else if (l->amount >= AMT_ACTIVITIES)
+		reply(s, STATUS_TOO_MANY_ACTIVITIES,
+			  STR_FAIL_NEW_ACTIVITY_TOO_MANY_ACTIVITIES);
+	else
+		return 1;
+
+	return 0;
+}
+
+/*
+ * CHECK PAGE
+ * Checks for the following errors related to the paginated commands:
+ *     - <cursor>: no such task.
+ *     - invalid page size.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream errors are written to.
+ *     - TaskList *l: pointer to the Kanban's task list.
+ *     - int page_sz: page size to be checked.
+ *     - int cursor: cursor to be checked.
+ * RETURN (int):
+ *     - returns 1 if there are no errors, 0 otherwise.
+ */
+int is_page_valid(Stream *s, TaskList *l, int page_sz, int cursor)
+{
+	if (cursor < 0 || cursor > l->amount)
+		reply(s, STATUS_NO_SUCH_TASK, STR_FAIL_LIST_TASKS_NO_SUCH_TASK, cursor);
+	else if (page_sz <= 0)
+		reply(s, STATUS_INVALID_PAGE_SIZE, STR_FAIL_PAGE_INVALID_PAGE_SIZE);
+	else
+		return 1;
+
+	return 0;
+}
+
+/*
+ * CHECK BATCH SIZE
+ * Checks for the following errors related to the batch move command:
+ *     - invalid batch size.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream errors are written to.
+ *     - int amount: amount of moves in the batch, negative if it was missing.
+ * RETURN (int):
+ *     - returns 1 if there are no errors, 0 otherwise.
+ */
+int is_batch_size_valid(Stream *s, int amount)
+{
+	if (amount < 0 || amount > AMT_TASKS)
+		reply(s, STATUS_INVALID_BATCH_SIZE, STR_FAIL_BATCH_INVALID_BATCH_SIZE);
+	else
+		return 1;
+
+	return 0;
+}
+
+
+/******************************************************************************
+ * AUXILIARY ERROR CHECKING FUNCTIONS                                         *
+ ******************************************************************************/
+
+/*
+ * CHECK FOR TASK DESCRIPTION DUPLICATES
+ * Checks if there's another task with the same description in the kanban.
+ * Tasks in the description order are binary searched, new ones are scanned.
+ *
+ * ARGS:
+ *     - TaskList *l: pointer to the Kanban's taks list.
+ *     - Task *t: pointer to the task whose description will be checked.
+ * RETURN (int):
+ *     - returns 1 if task descripion is duplicate, 0 otherwise.
+ */
+int is_task_description_duplicate(TaskList *l, Task *t)
+{
+	int i, cmp, start = 0, end = l->amount_sorted - 1;
+
+	while (end >= start) {
+		i = (start + end) / 2;
+		cmp = compare_descriptions(&l->task[l->ordered_by_description[i]], t);
+
+		if (cmp == EQUAL)
+			return 1;
+		else if (cmp > 0)
+			end = i - 1;
+		else
+			start = i + 1;
+	}
+
+	for (i = l->amount_sorted; i < l->amount; i++) {
+		if (compare_descriptions(t, &l->task[i]) == EQUAL)
+			return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * COMPARE TASK DESCRIPTIONS
+ * Compares the descriptions of two tasks, in the same way strcmp would.
+ *
+ * ARGS:
+ *     - Task *a, *b: pointers to the tasks whose descriptions will be compared.
+ * RETURN (int):
+ *     - returns EQUAL if the descriptions are the same, a negative number if
+ *       a comes first and a positive number if b comes first.
+ */
+int compare_descriptions(Task *a, Task *b)
+{
+	return strcmp(a->description, b->description);
+}
+
+/*
+ * COMPARE TASK STARTS
+ * Compares two tasks by start time, then by description.
+ *
+ * ARGS:
+ *     - Task *a, *b: pointers to the tasks that will be compared.
+ * RETURN (int):
+ *     - returns EQUAL if the tasks are the same, a negative number if a comes
+ *       first and a positive number if b comes first.
+ */
+int compare_starts(Task *a, Task *b)
+{
+	if (a->start != b->start)
+		return a->start < b->start ? -1 : 1;
+
+	return compare_descriptions(a, b);
+}
+
+/*
+ * CHECK IF USER EXISTS
+ * Check if user is already in the kanban.
+ *
+ * ARGS:
+ *     - UserList *l: pointer to the Kanban's user list.
+ *     - char user[]: user string to be checked.
+ * RETURN (int):
+ *     - returns 1 if user is already in the list, 0 otherwise.
+ */
+int is_existing_user(UserList *l, char user[])
+{
+	return find_user(l, user) != NO_USER;
+}
+
+/*
+ * FIND USER
+ * Looks up a user in the kanban.
+ *
+ * ARGS:
+ *     - UserList *l: pointer to the Kanban's user list.
+ *     - char user[]: user string to be looked up.
+ * RETURN (int):
+ *     - index of the user, NO_USER if it's not in the list.
+ */
+int find_user(UserList *l, char user[])
+{
+	char key[KEY_SZ];
+	unsigned long h;
+	int i;
+
+	if (l->amount_slots == 0)
+		return NO_USER;
+
+	to_key(key, user);
+	h = hash_str(key);
+
+	while ((i = l->slot[h & (l->amount_slots - 1)]) != NO_USER) {
+		if (memcmp(l->user[i], key, KEY_SZ) == EQUAL)
+			return i;
+		h++;
+	}
+
+	return NO_USER;
+}
+
+/*
+ * CHECK IF ACTIVITY EXISTS
+ * Check if activity is already in the kanban.
+ *
+ * ARGS:
+ *     - ActivityList *l: pointer to the Kanban's activity list.
+ *     - char activity[]: activity string to be checked.
+ * RETURN (int):
+ *     - returns 1 if activity is already in the list, 0 otherwise.
+ */
+int is_existing_activity(ActivityList *l, char activity[])
+{
+	return find_activity(l, activity) != NO_ACTIVITY;
+}
+
+/*
+ * FIND ACTIVITY
+ * Looks up an activity in the kanban.
+ *
+ * ARGS:
+ *     - ActivityList *l: pointer to the Kanban's activity list.
+ *     - char activity[]: activity string to be looked up.
+ * RETURN (int):
+ *     - index of the activity, NO_ACTIVITY if it's not in the list.
+ */
+int find_activity(ActivityList *l, char activity[])
+{
+	char key[KEY_SZ];
+
+	to_key(key, activity);
+
+	return find_key((const char (*)[KEY_SZ]) l->activity, l->amount, key);
+}
+
+/*
+ * FIND TRANSITION
+ * Binary searches a task's history for the last transition made until a
+ * given moment.
+ *
+ * ARGS:
+ *     - Task *t: pointer to the task.
+ *     - unsigned int time: the moment.
+ * RETURN (int):
+ *     - index of the transition in the history, NO_TRANSITION if the task
+ *       was created later.
+ */
+int find_transition(Task *t, unsigned int time)
+{
+	int start = 0, end = t->history_sz, middle;
+
+	while (start < end) {
+		middle = (start + end) / 2;
+		if (t->history[middle].time <= time)
+			start = middle + 1;
+		else
+			end = middle;
+	}
+
+	return start - 1;
+}
+
+/*
+ * FIND STATE
+ * Finds the user and activity a task had at a moment no earlier than the
+ * history horizon. A task with no history kept has had its state since
+ * before the horizon, so its current one is used.
+ *
+ * ARGS:
+ *     - Kanban *k: pointer to Kanban.
+ *     - Task *t: pointer to the task.
+ *     - unsigned int time: the moment.
+ *     - Transition *state: pointer to where the state is written.
+ * RETURN (int):
+ *     - returns 1 if the task existed at that moment, 0 otherwise.
+ */
+int find_state(Kanban *k, Task *t, unsigned int time, Transition *state)
+{
+	int i;
+
+	if (t->history_sz == 0) {
+		state->time = time;
+		state->activity = find_activity(&k->activities, t->activity);
+		state->user = state->activity == TO_DO ? NO_USER
+						: find_user(&k->users, t->user);
+		return 1;
+	}
+
+	if ((i = find_transition(t, time)) == NO_TRANSITION)
+		return 0;
+
+	*state = t->history[i];
+	return 1;
+}
+
+/*
+ * CHECK LOWERCASE
+ * Check if string contains lowercase characters.
+ *
+ * ARGS:
+ *     - char s[]: string to be checked.
+ * RETURN (int):
+ *     - returns 1 if string has any lowercase, 0 otherwise.
+ */
+int str_has_lowercase(char s[])
+{
+	char key[KEY_SZ];
+
+	to_key(key, s);
+
+	return has_lowercase(key);
+}
+
+
+/******************************************************************************
+ * PRINTING FUNCTIONS                                                         *
+ ******************************************************************************/
+
+/*
+ * PRINT TASK
+ * Print the task with the given id.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the task is printed to.
+ *     - TaskList *l: pointer to the Kanban's task list.
+ *     - int id: id of the task to be printed.
+ * RETURN (void).
+ */
+void print_task(Stream *s, TaskList *l, int id)
+{
+	reply(s, STATUS_OK, STR_SUCCESS_LIST_TASKS, id,
+		  l->task[id - 1].activity,
+		  l->task[id - 1].duration,
+		  l->task[id - 1].description);
+}
+
+/*
+ * PRINT ACTIVITY
+ * Print all tasks in an activity.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the activity is printed to.
+ *     - Kanban *k: pointer to Kanban.
+ *     - char activity[]: string of the activity to be printed.
+ *     - int order[]: order in wich the tasks in the activity will be printed.
+ *     - int sz: size of order vector.
+ * RETURN (void).
+ */
+void print_activity(Stream *s, Kanban *k, char activity[], int order[],
+					int sz)
+{
+	int i;
+	Task t;
+
+	TRACE_BEGIN("print_activity");
+
+	for (i = 0; i < sz; i++) {
+		t = k->tasks.task[order[i]];
+
+		if (strcmp(t.activity, activity) == EQUAL)
+			reply(s, STATUS_OK, STR_SUCCESS_DISPLAY_ACTIVITY, order[i] + 1,
+				  t.start, t.description);
+	}
+
+	TRACE_END("print_activity", sz);
+}
+
+/*
+ * PRINT ACTIVITY AT TIME
+ * Print all tasks that were in an activity at a past moment. Tasks that were
+ * still to do are printed as not started.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the activity is printed to.
+ *     - Kanban *k: pointer to Kanban.
+ *     - int activity: index of the activity to be printed.
+ *     - int order[]: order in wich the tasks in the activity will be printed.
+ *     - int sz: size of order vector.
+ *     - unsigned int time: the moment.
+ * RETURN (void).
+ */
+void print_activity_at(Stream *s, Kanban *k, int activity, int order[],
+					   int sz, unsigned int time)
+{
+	int i;
+	Task *t;
+	Transition state;
+
+	TRACE_BEGIN("print_activity_at");
+
+	for (i = 0; i < sz; i++) {
+		t = &k->tasks.task[order[i]];
+
+		if (find_state(k, t, time, &state) && state.activity == activity)
+			reply(s, STATUS_OK, STR_SUCCESS_DISPLAY_ACTIVITY, order[i] + 1,
+				  activity == TO_DO ? 0 : t->start,
+				  t->description);
+	}
+
+	TRACE_END("print_activity_at", sz);
+}
+
+/*
+ * PRINT ACTIVITY PAGE
+ * Print up to page_sz tasks in an activity, starting at a position of the
+ * order vector.
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the activity is printed to.
+ *     - Kanban *k: pointer to Kanban.
+ *     - char activity[]: string of the activity to be printed.
+ *     - int order[]: order in wich the tasks in the activity will be printed.
+ *     - int sz: size of order vector.
+ *     - int i: position of the order vector to start at.
+ *     - int page_sz: maximum amount of tasks to print.
+ * RETURN (int):
+ *     - id of the last task printed, 0 if the order vector ran out.
+ */
+int print_activity_page(Stream *s, Kanban *k, char activity[], int order[],
+						int sz, int i, int page_sz)
+{
+	Task t;
+
+	for (; i < sz && page_sz > 0; i++) {
+		t = k->tasks.task[order[i]];
+
+		if (strcmp(t.activity, activity) == EQUAL) {
+			reply(s, STATUS_OK, STR_SUCCESS_DISPLAY_ACTIVITY, order[i] + 1,
+				  t.start, t.description);
+			page_sz--;
+		}
+	}
+
+	return i < sz ? order[i - 1] + 1 : 0;
+}
+
+
+/******************************************************************************
+ * VECTOR MANIPULATION FUNCTIONS                                              *
+ ******************************************************************************/
+
+/*
+ * TASK ORDER SEARCH
+ * Find the position in the order vector that follows the task with a given
+ * id, that is, the first position holding a task that comes after it.
+ *
+ * ARGS:
+ *     - TaskList *l: pointer to the Kanban's task list.
+ *     - int order[]: order vector to search.
+ *     - int id: id of the task whose position will be found.
+ *     - int start, end: domain of the binary search.
+ *     - int (*compare)(Task *, Task *): comparison the order vector follows.
+ * RETURN (int):
+ *     - the position following the task, end + 1 if it is the last one.
+ */
+int binary_search(TaskList *l, int order[], int id, int start, int end,
+				  int (*compare)(Task *, Task *))
+{
+	int mid;
+
+	while (end >= start) {
+		mid = (start + end) / 2;
+
+		if (compare(&l->task[order[mid]], &l->task[id - 1]) > 0)
+			end = mid - 1;
+		else
+			start = mid + 1;
+	}
+
+	return start;
+}
+
+/*
+ * TASK ORDER INSERTION
  * Insert the index of the task with a given id into the order vector.
  *
  * ARGS:
@@ -842,36 +4495,296 @@ void print_activity(Kanban *k, char activity[], int order[], int sz)
  */
 void binary_insert(TaskList *l, int order[], int id, int start, int end)
 {
-	int mid, sz;
-	sz = end;
+	int pos;
 
-	while (end >= start) {
-		mid = (start + end) / 2;
+	TRACE_BEGIN("binary_insert");
 
-		if (strcmp(l->task[order[mid]].description,
-				   l->task[id - 1].description) > 0)
-			end = mid - 1;
+	pos = binary_search(l, order, id, start, end, compare_descriptions);
+	memmove(&order[pos + 1], &order[pos], sizeof(int) * (end - pos + 1));
+	order[pos] = id - 1;
+
+	TRACE_END("binary_insert", end - pos + 1);
+}
+
+/*
+ * TASK ORDER MERGE
+ * Merge the indices in ids[], already ordered by description, into the
+ * order vector. The order vector must have room for sz more indices after end.
+ *
+ * ARGS:
+ *     - TaskList *l: pointer to the Kanban's task list.
+ *     - int order[]: order vector where the indices will be inserted.
+ *     - int ids[]: indices to insert, ordered by description.
+ *     - int sz: size of ids vector.
+ *     - int start, end: domain of the order vector to merge with.
+ * RETURN (void).
+ */
+void merge_insert(TaskList *l, int order[], int ids[], int sz,
+				  int start, int end)
+{
+	int i = end, j = sz - 1, dest = end + sz;
+
+	while (j >= 0) {
+		if (i >= start &&
+			compare_descriptions(&l->task[order[i]], &l->task[ids[j]]) > 0)
+			order[dest--] = order[i--];
 		else
-			start = mid + 1;
+			order[dest--] = ids[j--];
 	}
+}
 
-	sz -= start - 1;
-	memmove(&order[start + 1], &order[start], sizeof(int) * sz);
-	order[start] = id - 1;
+/*
+ * TASK MERGE SORT
+ * Sort task indices by description.
+ *
+ * ARGS:
+ *     - TaskList *l: pointer to the Kanban's task list.
+ *     - int ids[]: indices to sort.
+ *     - int tmp[]: scratch space, with room for sz indices.
+ *     - int sz: size of ids vector.
+ * RETURN (void).
+ */
+void merge_sort(TaskList *l, int ids[], int tmp[], int sz)
+{
+	int half = sz / 2;
+
+	if (sz < 2)
+		return;
+
+	merge_sort(l, ids, tmp, half);
+	merge_sort(l, ids + half, tmp, sz - half);
+
+	memcpy(tmp, ids + half, sizeof(int) * (sz - half));
+	merge_insert(l, ids, tmp, sz - half, 0, half - 1);
+}
+
+/*
+ * SORT DESCRIPTIONS
+ * Sorts the new tasks at the end of the description order and merges them
+ * with the ones already sorted. New tasks are only appended to the order, so
+ * a run of them is sorted once, when the order is read or when there are
+ * MAX_UNSORTED_TASKS of them, as looking for duplicates scans them all.
+ *
+ * ARGS:
+ *     - TaskList *l: pointer to the Kanban's task list.
+ * RETURN (void).
+ */
+void sort_descriptions(TaskList *l)
+{
+	int sz = l->amount - l->amount_sorted;
+	int pending[AMT_TASKS];
+
+	if (sz == 0)
+		return;
+
+	TRACE_BEGIN("sort_descriptions");
+
+	merge_sort(l, &l->ordered_by_description[l->amount_sorted], pending, sz);
+	memcpy(pending, &l->ordered_by_description[l->amount_sorted],
+		   sizeof(int) * sz);
+	merge_insert(l, l->ordered_by_description, pending, sz,
+				 0, l->amount_sorted - 1);
+	l->amount_sorted = l->amount;
+
+	TRACE_END("sort_descriptions", sz);
 }
 
 /*
  * APPEND USER
- * Add user to the end of the user list.
+ * Add user to the end of the user list and to its hash table.
  *
  * ARGS:
  *     - UserList *l: pointer to the Kanban's user list.
  *     - char new_user[]: user string to append.
+ * RETURN (int):
+ *     - returns 1 on success, 0 if there was no memory for the user.
+ */
+int append_user(UserList *l, char new_user[])
+{
+	if (l->amount == l->capacity && !grow_users(l))
+		return 0;
+
+	to_key(l->user[l->amount], new_user);
+	l->tasks[l->amount].order = NULL;
+	l->tasks[l->amount].amount = 0;
+	l->tasks[l->amount].capacity = 0;
+	index_user(l, (l->amount)++);
+
+	return 1;
+}
+
+/*
+ * GROW USERS
+ * Doubles the capacity of the user list and its task indices. The hash table
+ * is rebuilt with twice as many slots as there are users, so it's never more
+ * than half full.
+ *
+ * ARGS:
+ *     - UserList *l: pointer to the Kanban's user list.
+ * RETURN (int):
+ *     - returns 1 on success, 0 if there was no memory.
+ */
+int grow_users(UserList *l)
+{
+	int i, capacity = l->capacity > 0 ? l->capacity * 2 : USERS_INITIAL_SZ;
+	int *slot;
+	void *user;
+	UserTasks *tasks;
+
+	if ((tasks = realloc(l->tasks, sizeof(UserTasks) * capacity)) == NULL)
+		return 0;
+	l->tasks = tasks;
+
+	if (posix_memalign(&user, KEY_SZ, (size_t) KEY_SZ * capacity) != 0)
+		return 0;
+	if ((slot = malloc(sizeof(int) * capacity * 2)) == NULL) {
+		free(user);
+		return 0;
+	}
+
+	if (l->amount > 0)
+		memcpy(user, l->user, (size_t) KEY_SZ * l->amount);
+	free(l->user);
+	free(l->slot);
+	l->heap_sz += (sizeof(UserTasks) + KEY_SZ + sizeof(int) * 2) *
+				  (capacity - l->capacity);
+	l->user = user;
+	l->capacity = capacity;
+	l->slot = slot;
+	l->amount_slots = capacity * 2;
+
+	for (i = 0; i < l->amount_slots; i++)
+		l->slot[i] = NO_USER;
+	for (i = 0; i < l->amount; i++)
+		index_user(l, i);
+
+	return 1;
+}
+
+/*
+ * INDEX USER
+ * Adds a user to the hash table of user keys.
+ *
+ * ARGS:
+ *     - UserList *l: pointer to the Kanban's user list.
+ *     - int i: index of the user.
+ * RETURN (void).
+ */
+void index_user(UserList *l, int i)
+{
+	unsigned long h = hash_str(l->user[i]);
+
+	while (l->slot[h & (l->amount_slots - 1)] != NO_USER)
+		h++;
+
+	l->slot[h & (l->amount_slots - 1)] = i;
+}
+
+/*
+ * ASSIGN TASK
+ * Inserts a started task into a user's task index, by start time. If the
+ * index can't grow, it is dropped until rebuild_user_tasks() is called.
+ *
+ * ARGS:
+ *     - UserList *l: pointer to the Kanban's user list.
+ *     - TaskList *tasks: pointer to the Kanban's task list.
+ *     - int user: index of the user.
+ *     - int id: id of the task.
+ * RETURN (void).
+ */
+void assign_task(UserList *l, TaskList *tasks, int user, int id)
+{
+	int pos, capacity, *order;
+	UserTasks *u = &l->tasks[user];
+
+	if (u->amount == NO_INDEX)
+		return;
+
+	if (u->amount == u->capacity) {
+		capacity = u->capacity > 0 ? u->capacity * 2 : USER_TASKS_INITIAL_SZ;
+		if ((order = realloc(u->order, sizeof(int) * capacity)) == NULL) {
+			free(u->order);
+			l->heap_sz -= sizeof(int) * u->capacity;
+			u->order = NULL;
+			u->amount = NO_INDEX;
+			u->capacity = 0;
+			return;
+		}
+		l->heap_sz += sizeof(int) * (capacity - u->capacity);
+		u->order = order;
+		u->capacity = capacity;
+	}
+
+	pos = binary_search(tasks, u->order, id, 0, u->amount - 1, compare_starts);
+	memmove(&u->order[pos + 1], &u->order[pos],
+			sizeof(int) * (u->amount - pos));
+	u->order[pos] = id - 1;
+	u->amount++;
+}
+
+/*
+ * UNASSIGN TASK
+ * Removes a task from a user's task index.
+ *
+ * ARGS:
+ *     - UserList *l: pointer to the Kanban's user list.
+ *     - TaskList *tasks: pointer to the Kanban's task list.
+ *     - int user: index of the user.
+ *     - int id: id of the task.
  * RETURN (void).
  */
-void append_user(UserList *l, char new_user[])
+void unassign_task(UserList *l, TaskList *tasks, int user, int id)
+{
+	int pos;
+	UserTasks *u = &l->tasks[user];
+
+	if (u->amount == NO_INDEX)
+		return;
+
+	pos = binary_search(tasks, u->order, id, 0, u->amount - 1,
+						compare_starts) - 1;
+	memmove(&u->order[pos], &u->order[pos + 1],
+			sizeof(int) * (u->amount - pos - 1));
+	u->amount--;
+}
+
+/*
+ * REBUILD USER TASKS
+ * Rebuilds a user's lost task index by going through the started tasks,
+ * which are already ordered by start time, then description.
+ *
+ * ARGS:
+ *     - UserList *l: pointer to the Kanban's user list.
+ *     - TaskList *tasks: pointer to the Kanban's task list.
+ *     - int user: index of the user.
+ * RETURN (int):
+ *     - returns 1 if the index was rebuilt, 0 if there's no memory for it.
+ */
+int rebuild_user_tasks(UserList *l, TaskList *tasks, int user)
 {
-	strcpy(l->user[(l->amount)++], new_user);
+	int i, amount = 0;
+	UserTasks *u = &l->tasks[user];
+
+	for (i = 0; i < tasks->amount_started; i++)
+		if (strcmp(tasks->task[tasks->ordered_by_start[i]].user,
+				   l->user[user]) == EQUAL)
+			amount++;
+
+	u->capacity = amount > USER_TASKS_INITIAL_SZ ? amount
+												 : USER_TASKS_INITIAL_SZ;
+	if ((u->order = malloc(sizeof(int) * u->capacity)) == NULL) {
+		u->capacity = 0;
+		return 0;
+	}
+	l->heap_sz += sizeof(int) * u->capacity;
+
+	u->amount = 0;
+	for (i = 0; i < tasks->amount_started; i++)
+		if (strcmp(tasks->task[tasks->ordered_by_start[i]].user,
+				   l->user[user]) == EQUAL)
+			u->order[u->amount++] = tasks->ordered_by_start[i];
+
+	return 1;
 }
 
 /*
@@ -885,7 +4798,7 @@ void append_user(UserList *l, char new_user[])
  */
 void append_activity(ActivityList *l, char new_activity[])
 {
-	strcpy(l->activity[(l->amount)++], new_activity);
+	to_key(l->activity[(l->amount)++], new_activity);
 }
 
 /*
@@ -901,3 +4814,263 @@ void append_task(TaskList *l, Task *new_task)
 {
 	memcpy(&l->task[(l->amount)++], new_task, sizeof(Task));
 }
+
+/*
+ * APPEND TRANSITION
+ * Add a transition to the end of a task's history. Once the history has
+ * HISTORY_RETENTION transitions (or there's no memory to grow it), the
+ * oldest is dropped and the history horizon moves past it. If none can be
+ * kept at all, the new one is dropped and the horizon moves up to it.
+ *
+ * ARGS:
+ *     - TaskList *l: pointer to the Kanban's task list.
+ *     - Task *t: pointer to the task.
+ *     - unsigned int time: moment of the transition.
+ *     - int activity: index of the activity entered.
+ *     - int user: index of the task's user, NO_USER if none.
+ * RETURN (void).
+ */
+void append_transition(TaskList *l, Task *t, unsigned int time,
+					   int activity, int user)
+{
+	Transition *history = NULL;
+
+	if (t->history_sz < HISTORY_RETENTION)
+		history = realloc(t->history, sizeof(Transition) * (t->history_sz + 1));
+
+	if (history != NULL) {
+		t->history = history;
+		l->heap_sz += sizeof(Transition);
+	} else if (t->history_sz > 0) {
+		memmove(t->history, t->history + 1,
+				sizeof(Transition) * --t->history_sz);
+		if (t->history[0].time > l->history_horizon)
+			l->history_horizon = t->history[0].time;
+	} else {
+		if (time > l->history_horizon)
+			l->history_horizon = time;
+		return;
+	}
+
+	t->history[t->history_sz].time = time;
+	t->history[t->history_sz].activity = activity;
+	t->history[t->history_sz].user = user;
+	t->history_sz++;
+}
+
+
+/******************************************************************************
+ * TRACING FUNCTIONS                                                          *
+ ******************************************************************************/
+
+#ifdef TRACE
+
+/*
+ * Rings of the threads that recorded events. A slot is stored before the
+ * count that publishes it is raised, so readers never see an unset slot.
+ */
+static TraceRing *trace_rings[TRACE_MAX_THREADS];
+static int trace_amount_rings = 0;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * DUMP TRACE HANDLING
+ * Related command: T <format> <path>
+ * Writes the events recorded by every thread to a file, either as Chrome
+ * trace-event JSON (format json) or as ftrace tracing_mark_write lines that
+ * perf and Perfetto can import (format perf).
+ *
+ * ARGS:
+ *     - Stream *s: pointer to the stream the command is read from.
+ * RETURN (int):
+ *     - continues the infinite loop if KEEP_GOING.
+ */
+int dump_trace(Stream *s)
+{
+	int i, json, amount_rings, amount = 0;
+	unsigned long j;
+	char format[TRACE_FORMAT_SZ], path[TRACE_PATH_SZ];
+	FILE *f;
+	TraceRing *r;
+	TraceEvent *e;
+
+	if (s->binary) {
+		decode_word(s, format, TRACE_FORMAT_SZ);
+		decode_word(s, path, TRACE_PATH_SZ);
+	} else
+		fscanf(s->in, STR_MATCH_TRACE, format, path);
+
+	json = strcmp(format, TRACE_FORMAT_JSON) == EQUAL;
+	if ((!json && strcmp(format, TRACE_FORMAT_PERF) != EQUAL) ||
+		(f = fopen(path, "w")) == NULL) {
+		reply(s, STATUS_CANNOT_DUMP_TRACE, STR_FAIL_DUMP_TRACE);
+		return KEEP_GOING;
+	}
+
+	if (json)
+		fprintf(f, STR_TRACE_JSON_BEGIN);
+
+	amount_rings = trace_amount_rings;
+	__sync_synchronize();
+
+	for (i = 0; i < amount_rings; i++) {
+		if ((r = trace_rings[i]) == NULL)
+			continue;
+
+		__sync_synchronize();
+		j = r->amount > TRACE_RING_SZ ? r->amount - TRACE_RING_SZ : 0;
+
+		for (; j < r->amount; j++, amount++) {
+			e = &r->event[j % TRACE_RING_SZ];
+
+			if (json)
+				fprintf(f, STR_TRACE_JSON_EVENT, amount > 0 ? "," : "",
+						e->name, e->phase, e->ts, (int) getpid(), r->tid,
+						e->arg);
+			else
+				fprintf(f, STR_TRACE_PERF_EVENT, r->tid, e->ts / 1000000,
+						e->ts % 1000000, e->phase, (int) getpid(), e->name);
+		}
+	}
+
+	if (json)
+		fprintf(f, STR_TRACE_JSON_END);
+
+	fclose(f);
+	reply(s, STATUS_OK, STR_SUCCESS_DUMP_TRACE, amount);
+
+	return KEEP_GOING;
+}
+
+/*
+ * COMMAND NAME
+ * Names the event of a command after the function that handles it.
+ *
+ * ARGS:
+ *     - char cmd_code: command character.
+ * RETURN (const char *):
+ *     - name of the command's event.
+ */
+const char *command_name(char cmd_code)
+{
+	switch (cmd_code) {
+		case 'q':
+			return "quit";
+		case 't':
+			return "new_task";
+		case 'l':
+			return "list_tasks";
+		case 'n':
+			return "advance_time";
+		case 'u':
+			return "handle_users";
+		case 'm':
+			return "move_task";
+		case 'M':
+			return "batch_move_tasks";
+		case 'L':
+			return "list_tasks_page";
+		case 'd':
+			return "display_activity";
+		case 'D':
+			return "display_activity_page";
+		case 'a':
+			return "handle_activities";
+		case 's':
+			return "subscribe";
+		case 'e':
+			return "read_changes";
+		case 'x':
+			return "unsubscribe";
+		case 'h':
+			return "display_activity_at";
+		case 'H':
+			return "task_at";
+		case 'w':
+			return "list_user_tasks";
+		case 'T':
+			return "dump_trace";
+		case 'K':
+			return "bench_keys";
+		default:
+			return "unknown_command";
+	}
+}
+
+/*
+ * TRACE EVENT
+ * Records an event in the calling thread's ring, dropping it if the thread
+ * has no ring.
+ *
+ * ARGS:
+ *     - const char *name: name of the event, must outlive the trace.
+ *     - char phase: TRACE_PHASE_BEGIN or TRACE_PHASE_END.
+ *     - int arg: integer argument of the event.
+ * RETURN (void).
+ */
+void trace_event(const char *name, char phase, int arg)
+{
+	struct timespec now;
+	TraceRing *r;
+	TraceEvent *e;
+
+	if ((r = trace_ring()) == NULL)
+		return;
+
+	e = &r->event[r->amount % TRACE_RING_SZ];
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	e->name = name;
+	e->phase = phase;
+	e->arg = arg;
+	e->ts = now.tv_sec * 1000000UL + now.tv_nsec / 1000;
+
+	__sync_synchronize();
+	r->amount++;
+}
+
+/*
+ * TRACE RESULT
+ * Records the end of an event whose argument is a function's result.
+ *
+ * ARGS:
+ *     - const char *name: name of the event.
+ *     - int result: result of the traced function.
+ * RETURN (int):
+ *     - the result, unchanged.
+ */
+int trace_result(const char *name, int result)
+{
+	TRACE_END(name, result);
+	return result;
+}
+
+/*
+ * TRACE RING
+ * Gets the calling thread's ring, creating and registering it the first time.
+ * Threads past TRACE_MAX_THREADS record into a ring that is never dumped.
+ *
+ * ARGS: none.
+ * RETURN (TraceRing *):
+ *     - pointer to the calling thread's ring, NULL if it cannot be allocated.
+ */
+TraceRing *trace_ring(void)
+{
+	static __thread TraceRing *ring = NULL;
+	static int amount_threads = 0;
+
+	if (ring == NULL && (ring = calloc(1, sizeof(TraceRing))) != NULL) {
+		pthread_mutex_lock(&trace_lock);
+		ring->tid = ++amount_threads;
+		if (trace_amount_rings < TRACE_MAX_THREADS) {
+			trace_rings[trace_amount_rings] = ring;
+			__sync_synchronize();
+			trace_amount_rings++;
+		}
+		pthread_mutex_unlock(&trace_lock);
+	}
+
+	return ring;
+}
+
+#endif
@@ -0,0 +1,45 @@
+#!/bin/sh
+#
+# Runs every tests/<name>.in through the kanban and compares what it prints
+# with tests/<name>.out. A test with a tests/<name>.flags file runs on a
+# build compiled with those extra flags, e.g. to force boards to hibernate.
+# A tests/<name>.args file holds arguments for the kanban itself, e.g. -b.
+# Binary protocol tests read tests/<name>.bin instead of tests/<name>.in;
+# binary.bin is bench/encode.py's encoding of binary.txt.
+#
+# Usage: tests/run.sh [<name> ...]
+
+cd "$(dirname "$0")" || exit 1
+
+CC=${CC:-gcc}
+CFLAGS="-Wall -Wextra -Werror -ansi -pedantic"
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+if [ $# -eq 0 ]; then
+	set -- $(ls *.in *.bin 2>/dev/null | sed 's/\.in$//; s/\.bin$//')
+fi
+
+failed=0
+for name in "$@"; do
+	flags=""
+	[ -f "$name.flags" ] && flags=$(cat "$name.flags")
+	args=""
+	[ -f "$name.args" ] && args=$(cat "$name.args")
+	input="$name.in"
+	[ -f "$input" ] || input="$name.bin"
+
+	if ! $CC $CFLAGS $flags -o "$tmp/kanban" ../main.c -lpthread; then
+		echo "FAIL $name (build)"
+		failed=1
+	elif "$tmp/kanban" $args < "$input" > "$tmp/out" &&
+		diff "$name.out" "$tmp/out" > "$tmp/diff"; then
+		echo "ok   $name"
+	else
+		echo "FAIL $name"
+		cat "$tmp/diff"
+		failed=1
+	fi
+done
+
+exit $failed